@@ -0,0 +1,483 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "Mesh/Mesh.hpp"
+
+/*
+	Synthesizes a mesh with known Gaussian peaks, runs it through the centroid stages and the peak finding modes,
+	and reports how long each one takes and how many of the synthesized peaks it recovers. A mode that is faster
+	but loses peaks shows up as a lower recall next to its timing.
+*/
+
+using namespace std;
+
+// A synthesized peak, in index space.
+struct TruePeak
+{
+	double i;
+	double j;
+	double height;
+};
+
+struct BenchSettings
+{
+	int				nmz				= 4000;
+	int				nrt				= 1000;
+	int				peak_count		= 2000;
+	double			overlap			= 0.1;
+	double			separation		= 2.0;
+	double			noise			= 0.5;
+	double			min_height		= 10.0;
+	double			dynamic_range	= 3.0;
+	double			mz_sigma		= 2.0;
+	double			rt_sigma		= 3.0;
+	double			tolerance		= 1.5;
+	int				npeaks			= 0;
+	int				repeat			= 3;
+	int				threads			= 0;
+	int				coarse_factor	= 8;
+	int				band_rows		= 64;
+	unsigned int	seed			= 1;
+	std::string		directory		= ".";
+};
+
+// Recall and precision of a set of found peaks against the synthesized ones.
+struct Score
+{
+	size_t	matched		= 0;
+	size_t	found		= 0;
+	double	recall		= 0;
+	double	precision	= 0;
+	double	position	= 0;
+	double	height		= 0;
+};
+
+// Returns the time in milliseconds taken by the fastest of repeat calls to stage.
+template <typename Stage>
+double Time(const int repeat, Stage stage)
+{
+	double best = 0;
+	for (int r = 0; r < repeat; ++r)
+	{
+		auto start = chrono::steady_clock::now();
+		stage();
+		double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		if (r == 0 || elapsed < best)
+		{
+			best = elapsed;
+		}
+	}
+	return best;
+}
+
+// Places the peaks at random, moving a fraction of them next to an earlier one, and writes the mesh and data files.
+std::vector<TruePeak> Synthesize(const BenchSettings& settings, const std::string& meshname, const std::string& datname)
+{
+	mt19937 random(settings.seed);
+	uniform_real_distribution<double> uniform(0.0, 1.0);
+	normal_distribution<double> normal(0.0, 1.0);
+
+	const int margin = 4;
+	std::vector<TruePeak> truth;
+	truth.reserve(settings.peak_count);
+	for (int p = 0; p < settings.peak_count; ++p)
+	{
+		TruePeak peak;
+		peak.height = settings.min_height * pow(10.0, uniform(random) * settings.dynamic_range);
+		if (!truth.empty() && uniform(random) < settings.overlap)
+		{
+			const TruePeak& neighbour = truth[random() % truth.size()];
+			double angle = uniform(random) * 2 * acos(-1.0);
+			peak.i = neighbour.i + cos(angle) * settings.separation * settings.mz_sigma;
+			peak.j = neighbour.j + sin(angle) * settings.separation * settings.rt_sigma;
+		}
+		else
+		{
+			peak.i = margin + uniform(random) * (settings.nmz - 2 * margin - 1);
+			peak.j = margin + uniform(random) * (settings.nrt - 2 * margin - 1);
+		}
+		peak.i = min(max(peak.i, (double)margin), (double)(settings.nmz - margin - 1));
+		peak.j = min(max(peak.j, (double)margin), (double)(settings.nrt - margin - 1));
+		truth.push_back(peak);
+	}
+
+	std::vector<float> values((size_t)settings.nmz * settings.nrt);
+	for (float& value : values)
+	{
+		value = fabs(normal(random)) * settings.noise;
+	}
+	for (const TruePeak& peak : truth)
+	{
+		int wi = (int)ceil(4 * settings.mz_sigma);
+		int wj = (int)ceil(4 * settings.rt_sigma);
+		int i0 = max(0, (int)peak.i - wi), i1 = min(settings.nmz - 1, (int)peak.i + wi + 1);
+		int j0 = max(0, (int)peak.j - wj), j1 = min(settings.nrt - 1, (int)peak.j + wj + 1);
+		for (int j = j0; j <= j1; ++j)
+		{
+			double dj = (j - peak.j) / settings.rt_sigma;
+			for (int i = i0; i <= i1; ++i)
+			{
+				double di = (i - peak.i) / settings.mz_sigma;
+				values[(size_t)j * settings.nmz + i] += peak.height * exp(-0.5 * (di * di + dj * dj));
+			}
+		}
+	}
+
+	FILE* f = fopen(datname.c_str(), "wb");
+	if (!f || fwrite(values.data(), sizeof(float), values.size(), f) != values.size())
+	{
+		cerr << "Error - cannot write " << datname << endl;
+		exit(-1);
+	}
+	fclose(f);
+
+	ConversionSpecs conversion;
+	conversion.mNMZ			= settings.nmz;
+	conversion.mNRT			= settings.nrt;
+	conversion.mDMZ			= 0.005;
+	conversion.mDRT			= 0.5;
+	conversion.mSigmaMZ		= conversion.mDMZ * settings.mz_sigma;
+	conversion.mSigmaRT		= conversion.mDRT * settings.rt_sigma;
+	conversion.mMinMZ		= 400;
+	conversion.mMinRT		= 0;
+	conversion.mMaxMZ		= conversion.mMinMZ + conversion.mDMZ * settings.nmz;
+	conversion.mMaxRT		= conversion.mMinRT + conversion.mDRT * settings.nrt;
+	conversion.mWarpedMesh		= 0;
+	conversion.mMassResolution	= 0;
+	conversion.mMassSpecType	= ConversionSpecs::QUAD;
+	conversion.mMZAtSigma		= conversion.mMinMZ;
+	conversion.Dump((char*)meshname.c_str(), (char*)datname.c_str());
+
+	return truth;
+}
+
+// Sets up a mesh the way centroid does once the header has been read.
+void Prepare(Mesh& mesh)
+{
+	mesh.mConversion.mMeshLittleEndian	= FS_LITTLEENDIAN;
+	mesh.mConversion.mWarpedMesh		= 0;
+	mesh.mConversion.mMassSpecType		= ConversionSpecs::QUAD;
+	mesh.mConversion.mMZAtSigma			= 400;
+}
+
+// Matches the found peaks to the synthesized ones, highest first, each within tolerance sigmas of the other.
+Score Match(const BenchSettings& settings, const Mesh& mesh, const std::vector<TruePeak>& truth)
+{
+	const double cell_i = settings.tolerance * settings.mz_sigma;
+	const double cell_j = settings.tolerance * settings.rt_sigma;
+	const int grid_i = (int)(settings.nmz / cell_i) + 1;
+	const int grid_j = (int)(settings.nrt / cell_j) + 1;
+
+	// Buckets the found peaks so that each match only looks at the cells around it.
+	std::vector<double> found_i, found_j;
+	std::vector<std::vector<size_t>> grid((size_t)grid_i * grid_j);
+	for (const Peak& peak : mesh.peaks)
+	{
+		double i = mesh.mConversion.WorldToIndexX(peak.mX);
+		double j = mesh.mConversion.MeshToIndexY(peak.mY);
+		int gi = min(max((int)(i / cell_i), 0), grid_i - 1);
+		int gj = min(max((int)(j / cell_j), 0), grid_j - 1);
+		grid[(size_t)gj * grid_i + gi].push_back(found_i.size());
+		found_i.push_back(i);
+		found_j.push_back(j);
+	}
+
+	std::vector<size_t> order(truth.size());
+	for (size_t t = 0; t < order.size(); ++t)
+	{
+		order[t] = t;
+	}
+	sort(order.begin(), order.end(), [&](size_t a, size_t b) { return truth[a].height > truth[b].height; });
+
+	Score score;
+	score.found = found_i.size();
+	std::vector<bool> used(found_i.size(), false);
+	for (size_t t : order)
+	{
+		const TruePeak& peak = truth[t];
+		int gi = (int)(peak.i / cell_i);
+		int gj = (int)(peak.j / cell_j);
+		double best_distance = 1.0;
+		size_t best = found_i.size();
+		for (int y = max(gj - 1, 0); y <= min(gj + 1, grid_j - 1); ++y)
+		{
+			for (int x = max(gi - 1, 0); x <= min(gi + 1, grid_i - 1); ++x)
+			{
+				for (size_t f : grid[(size_t)y * grid_i + x])
+				{
+					double di = (found_i[f] - peak.i) / cell_i;
+					double dj = (found_j[f] - peak.j) / cell_j;
+					double distance = di * di + dj * dj;
+					if (!used[f] && distance <= best_distance)
+					{
+						best_distance = distance;
+						best = f;
+					}
+				}
+			}
+		}
+
+		if (best < found_i.size())
+		{
+			used[best] = true;
+			++score.matched;
+			score.position += hypot(found_i[best] - peak.i, found_j[best] - peak.j);
+			score.height += fabs(mesh.peaks[best].mHeight - peak.height) / peak.height;
+		}
+	}
+
+	score.recall	= truth.empty() ? 0 : (double)score.matched / truth.size();
+	score.precision	= score.found == 0 ? 0 : (double)score.matched / score.found;
+	if (score.matched > 0)
+	{
+		score.position	/= score.matched;
+		score.height	/= score.matched;
+	}
+	return score;
+}
+
+// Checks whether two meshes found the same peaks in the same order.
+bool SamePeaks(const Mesh& a, const Mesh& b)
+{
+	if (a.peaks.size() != b.peaks.size())
+	{
+		return false;
+	}
+	for (size_t p = 0; p < a.peaks.size(); ++p)
+	{
+		if (a.peaks[p].mX != b.peaks[p].mX || a.peaks[p].mY != b.peaks[p].mY || a.peaks[p].mVolume != b.peaks[p].mVolume)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void Report(const std::string& mode, const double milliseconds, const Score& score, const std::string& note)
+{
+	cout << left << setw(12) << mode << right << fixed
+		<< setw(12) << setprecision(2) << milliseconds
+		<< setw(10) << score.found
+		<< setw(10) << score.matched
+		<< setw(10) << setprecision(4) << score.recall
+		<< setw(10) << setprecision(4) << score.precision
+		<< setw(10) << setprecision(3) << score.position
+		<< setw(10) << setprecision(3) << score.height
+		<< "  " << note << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchSettings settings;
+	double thresh = 0.05;
+	double peakheightmin = 3;
+
+	for (int narg = 1; narg < argc; ++narg)
+	{
+		std::string arg(argv[narg]);
+		if (narg + 1 >= argc && arg != "-h")
+		{
+			cerr << "Argument " << arg << " is missing its value. Terminating" << endl;
+			exit(-1);
+		}
+
+		if (arg == "-h")
+		{
+			cout << argv[0] << " <options>" << endl <<
+				"-nmz, -nrt The size of the synthesized mesh (default 4000 x 1000)." << endl <<
+				"-peaks The amount of synthesized peaks (default 2000)." << endl <<
+				"-overlap The fraction of peaks placed next to an earlier peak (default 0.1)." << endl <<
+				"-separation The distance in sigmas between overlapping peaks (default 2)." << endl <<
+				"-noise The scale of the half normal background noise (default 0.5)." << endl <<
+				"-height The height of the lowest peak (default 10)." << endl <<
+				"-range The decades of peak height above -height (default 3)." << endl <<
+				"-mz_sigma, -rt_sigma The peak widths in cells (default 2 and 3)." << endl <<
+				"-tolerance The distance in sigmas within which a found peak matches a synthesized one (default 1.5)." << endl <<
+				"-npeaks The amount of peaks to find (default twice -peaks)." << endl <<
+				"-threshold, -heightmin ConversionPeakThreshold and ConversionPeakHeightMin (default 0.05 and 3)." << endl <<
+				"-repeat The amount of runs of each stage, of which the fastest is reported (default 3)." << endl <<
+				"-threads, -coarse, -band The settings of the parallel, coarse and band modes (default 0, 8 and 64)." << endl <<
+				"-seed The seed of the synthesized mesh (default 1)." << endl <<
+				"-dir The directory the mesh files are written to (default .)." << endl;
+			exit(0);
+		}
+		else if (arg == "-nmz")			settings.nmz = atoi(argv[++narg]);
+		else if (arg == "-nrt")			settings.nrt = atoi(argv[++narg]);
+		else if (arg == "-peaks")		settings.peak_count = atoi(argv[++narg]);
+		else if (arg == "-overlap")		settings.overlap = atof(argv[++narg]);
+		else if (arg == "-separation")	settings.separation = atof(argv[++narg]);
+		else if (arg == "-noise")		settings.noise = atof(argv[++narg]);
+		else if (arg == "-height")		settings.min_height = atof(argv[++narg]);
+		else if (arg == "-range")		settings.dynamic_range = atof(argv[++narg]);
+		else if (arg == "-mz_sigma")	settings.mz_sigma = atof(argv[++narg]);
+		else if (arg == "-rt_sigma")	settings.rt_sigma = atof(argv[++narg]);
+		else if (arg == "-tolerance")	settings.tolerance = atof(argv[++narg]);
+		else if (arg == "-npeaks")		settings.npeaks = atoi(argv[++narg]);
+		else if (arg == "-threshold")	thresh = atof(argv[++narg]);
+		else if (arg == "-heightmin")	peakheightmin = atof(argv[++narg]);
+		else if (arg == "-repeat")		settings.repeat = max(1, atoi(argv[++narg]));
+		else if (arg == "-threads")		settings.threads = atoi(argv[++narg]);
+		else if (arg == "-coarse")		settings.coarse_factor = atoi(argv[++narg]);
+		else if (arg == "-band")		settings.band_rows = atoi(argv[++narg]);
+		else if (arg == "-seed")		settings.seed = atoi(argv[++narg]);
+		else if (arg == "-dir")			settings.directory = argv[++narg];
+		else
+		{
+			cerr << "Argument " << arg << " not recognized. Terminating" << endl;
+			exit(-1);
+		}
+	}
+
+	if (settings.nmz < 16 || settings.nrt < 16)
+	{
+		cerr << "The mesh must be at least 16 x 16 cells." << endl;
+		exit(-1);
+	}
+	if (settings.npeaks <= 0)
+	{
+		settings.npeaks = max(1, 2 * settings.peak_count);
+	}
+
+	FSLittleEndian::get();
+
+	const std::string meshname	= settings.directory + "/tapp_bench_centroid.mesh";
+	const std::string datname	= settings.directory + "/tapp_bench_centroid.dat";
+	const std::string pksname	= settings.directory + "/tapp_bench_centroid.pks";
+	std::vector<TruePeak> truth(Synthesize(settings, meshname, datname));
+
+	cout << "Mesh " << settings.nmz << " x " << settings.nrt << ", " << truth.size() << " peaks, overlap " << settings.overlap
+		<< ", noise " << settings.noise << ", heights " << settings.min_height << " to "
+		<< settings.min_height * pow(10.0, settings.dynamic_range) << endl << endl;
+
+	// Times the stages of FindPeaks one by one. The windowed centroid is part of measuring a peak, so it is
+	// timed again on its own and the region growing is what remains.
+	Mesh staged;
+	Prepare(staged);
+	double load_time = Time(settings.repeat, [&]() { staged.loadFromFile(meshname.c_str()); });
+
+	const int nmz = staged.mConversion.mNMZ;
+	const int nrt = staged.mConversion.mNRT;
+	MeshWindow window;
+	window.set(staged.v.get(), staged.hit.get(), nmz, nmz, nrt, 0, 0, nmz, nrt);
+
+	double scan_time = Time(settings.repeat, [&]()
+	{
+		PeakSelector selector(settings.npeaks);
+		std::vector<int> columns;
+		for (int y = 1; y < nrt - 1; ++y)
+		{
+			columns.clear();
+			window.FindRowPeaks(y, columns);
+			for (int x : columns)
+			{
+				selector.Add(x, y, staged.v[staged.Index(x, y)]);
+			}
+		}
+		staged.SetPeaks(selector);
+	});
+	const std::vector<Peak> candidates(staged.peaks);
+
+	double measure_time = Time(settings.repeat, [&]()
+	{
+		std::fill(staged.hit.get(), staged.hit.get() + (size_t)nmz * nrt, 0);
+		staged.peaks = candidates;
+		for (size_t p = 0; p < staged.peaks.size(); ++p)
+		{
+			staged.MeasurePeak(window, staged.peaks[p], p, thresh, peakheightmin);
+		}
+	});
+	const std::vector<Peak> measured(staged.peaks);
+
+	double centroid_time = Time(settings.repeat, [&]()
+	{
+		for (size_t p = 0; p < candidates.size(); ++p)
+		{
+			Peak peak(candidates[p]);
+			window.FindWindowedCentroid(peak);
+		}
+	});
+
+	staged.peaks = measured;
+	staged.FinalizePeaks();
+
+	double dump_time = Time(settings.repeat, [&]()
+	{
+		ofstream out(pksname);
+		staged.DumpPeaks(out);
+	});
+
+	Score staged_score(Match(settings, staged, truth));
+	cout << "Stage              ms" << endl << fixed << setprecision(2)
+		<< "loadFromFile " << setw(12) << load_time << endl
+		<< "scan         " << setw(12) << scan_time << "  " << candidates.size() << " candidates" << endl
+		<< "region       " << setw(12) << max(0.0, measure_time - centroid_time) << endl
+		<< "centroid     " << setw(12) << centroid_time << endl
+		<< "DumpPeaks    " << setw(12) << dump_time << "  " << staged.peaks.size() << " peaks" << endl << endl;
+
+	// Times each peak finding mode from loading the mesh to the final peaks, and scores it.
+	cout << left << setw(12) << "Mode" << right << setw(12) << "ms" << setw(10) << "found" << setw(10) << "matched"
+		<< setw(10) << "recall" << setw(10) << "precision" << setw(10) << "dpos" << setw(10) << "dheight" << endl;
+
+	Mesh full;
+	Prepare(full);
+	double full_time = Time(settings.repeat, [&]()
+	{
+		full.loadFromFile(meshname.c_str());
+		full.FindPeaks(settings.npeaks, thresh, peakheightmin);
+	});
+	Report("full", full_time, Match(settings, full, truth), SamePeaks(full, staged) ? "" : "differs from the stages");
+
+	Mesh parallel;
+	Prepare(parallel);
+	double parallel_time = Time(settings.repeat, [&]()
+	{
+		parallel.loadFromFile(meshname.c_str());
+		parallel.FindPeaksParallel(settings.npeaks, thresh, peakheightmin, settings.threads, 64, 16);
+	});
+	Report("parallel", parallel_time, Match(settings, parallel, truth), SamePeaks(parallel, full) ? "same as full" : "differs from full");
+
+	if (settings.band_rows > 0)
+	{
+		Mesh band;
+		Prepare(band);
+		double band_time = Time(settings.repeat, [&]()
+		{
+			band.loadHeaderFromFile(meshname.c_str());
+			band.FindPeaksOutOfCore(settings.npeaks, thresh, peakheightmin, settings.band_rows, 16);
+		});
+		Report("band", band_time, Match(settings, band, truth), SamePeaks(band, full) ? "same as full" : "differs from full");
+	}
+
+	if (settings.coarse_factor > 0)
+	{
+		Mesh coarse;
+		Prepare(coarse);
+		double coarse_time = Time(settings.repeat, [&]()
+		{
+			coarse.loadFromFile(meshname.c_str());
+			coarse.FindPeaksCoarse(settings.npeaks, thresh, peakheightmin, settings.coarse_factor);
+		});
+		Report("coarse", coarse_time, Match(settings, coarse, truth), "peaks below -heightmin are skipped");
+	}
+
+	cout << endl << "recall and precision count synthesized peaks matched within " << settings.tolerance
+		<< " sigmas, dpos is the mean distance in cells and dheight the mean relative height error." << endl;
+
+	remove(meshname.c_str());
+	remove(datname.c_str());
+	remove(pksname.c_str());
+	return 0;
+}
@@ -3,20 +3,25 @@
 // This source code is licensed under the Apache License, Version 2.0 found in
 // the LICENSE.md file in the root directory of this source tree.
 
+#include <atomic>
 #include <cmath>
 #include <iostream>
 #include <stdlib.h>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include "LCMSFile/LCMSFile.h"
 #include "Mesh/Mesh.hpp"
 
-#include "Filetypes/MzXML/MzXML_Parser.h"
+#include "Filetypes/MzXML/ScanIndex.h"
+#include "Filetypes/MzXML/ScanSidecar.h"
 #include "Filetypes/Mzid/Mzid_Parser.h"
 #include "Filetypes/FileRelations/FileRelations.h"
 #include "Filetypes/TAPP/IPL.h"
 #include "Filetypes/TAPP/TAPP_Output.h"
+#include "Utilities/MemoryBudget.hpp"
+#include "Utilities/Parallel.hpp"
 
 #ifndef LOAD_MIDAS
 using namespace std;
@@ -200,6 +205,192 @@ std::map<size_t, std::vector<MassSpectrometry::Isotope::IsotopicCluster>> Annota
 }
 #endif
 
+// The settings of the peak search, shared by all meshes of a -batch run.
+struct PeakSearch
+{
+	int		npeaks;
+	int		band_rows;
+	int		halo_rows;
+	int		thread_count;
+	int		tile_rows;
+	int		coarse_factor;
+	bool	smooth_mesh;
+	bool	watershed;
+};
+
+// Finds the peaks of a mesh whose conversion holds the header settings, streaming it in bands or loading it whole.
+void FindMeshPeaks(Mesh& mesh, const char* mesh_filepath, const PeakSearch& search)
+{
+	const ConversionSpecs& conversion(mesh.mConversion);
+	if (search.band_rows > 0)
+	{
+		mesh.loadHeaderFromFile(mesh_filepath);
+		MeshSmoother smoother;
+		if (search.smooth_mesh)
+		{
+			smoother = MeshSmoother(conversion.mSmoothWindow, conversion.mSmoothMethod, search.thread_count);
+		}
+		mesh.FindPeaksOutOfCore(search.npeaks, conversion.mPeakThreshold, conversion.mPeakHeightMin, search.band_rows, search.halo_rows, smoother);
+		return;
+	}
+
+	mesh.loadFromFile(mesh_filepath);
+	if (search.smooth_mesh)
+	{
+		mesh.Smooth(MeshSmoother(conversion.mSmoothWindow, conversion.mSmoothMethod, search.thread_count));
+	}
+	if (search.watershed)
+	{
+		mesh.FindPeaksWatershed(search.npeaks, conversion.mPeakThreshold, conversion.mPeakHeightMin);
+	}
+	else if (search.coarse_factor > 0)
+	{
+		mesh.FindPeaksCoarse(search.npeaks, conversion.mPeakThreshold, conversion.mPeakHeightMin, search.coarse_factor);
+	}
+	else if (search.thread_count != 1)
+	{
+		mesh.FindPeaksParallel(search.npeaks, conversion.mPeakThreshold, conversion.mPeakHeightMin, search.thread_count, search.tile_rows, search.halo_rows);
+	}
+	else
+	{
+		mesh.FindPeaks(search.npeaks, conversion.mPeakThreshold, conversion.mPeakHeightMin);
+	}
+}
+
+// Returns the bytes FindMeshPeaks allocates for a mesh whose header is loaded: the values and labels of the mesh or of
+// a band, a smoothed copy of the values, and the peaks.
+size_t PeakSearchMemory(const Mesh& mesh, const PeakSearch& search)
+{
+	size_t rows = search.band_rows > 0 ? search.band_rows + 2 * search.halo_rows : mesh.mConversion.mNRT;
+	size_t cells = std::min<size_t>(rows, mesh.mConversion.mNRT) * mesh.mConversion.mNMZ;
+	size_t cell_size = sizeof(float) + sizeof(int) + (search.smooth_mesh ? sizeof(float) : 0);
+	return cells * cell_size + std::max(search.npeaks, 0) * 2 * sizeof(Peak);
+}
+
+// Reads a -batch manifest, with a mesh and optionally the name of its output on each line. A .dat file stands for the
+// .mesh file next to it, and the output defaults to the mesh name without its extension. Blank lines and lines
+// starting with # are skipped.
+std::vector<std::pair<std::string, std::string>> ReadManifest(const std::string& filepath)
+{
+	std::ifstream reader(filepath);
+	if (!reader.is_open())
+	{
+		std::cout << "Centroid: cannot open the manifest " << filepath << "." << std::endl;
+		exit(-1);
+	}
+
+	std::vector<std::pair<std::string, std::string>> jobs;
+	std::string line;
+	while (std::getline(reader, line))
+	{
+		std::istringstream fields(line);
+		std::string mesh_filepath, output_name;
+		if (!(fields >> mesh_filepath) || mesh_filepath[0] == '#')
+		{
+			continue;
+		}
+
+		size_t extension = mesh_filepath.find_last_of('.');
+		std::string stem(extension == std::string::npos ? mesh_filepath : mesh_filepath.substr(0, extension));
+		if (mesh_filepath.compare(stem.size(), std::string::npos, ".dat") == 0)
+		{
+			mesh_filepath = stem + ".mesh";
+		}
+		if (!(fields >> output_name))
+		{
+			output_name = stem;
+		}
+
+		if (!std::ifstream(mesh_filepath).is_open())
+		{
+			std::cout << "Centroid: cannot open " << mesh_filepath << ", listed in " << filepath << "." << std::endl;
+			exit(-1);
+		}
+		jobs.push_back({ mesh_filepath, output_name });
+	}
+	return jobs;
+}
+
+// Finds and writes the peaks of each mesh of a manifest, with the header settings of settings. The meshes are handed
+// to worker_count threads, which only start on one once its memory fits in the budget. Each worker keeps its Mesh, and
+// the memory reserved for it, from one mesh to the next, so a mesh of the same size as the previous one reuses the
+// buffers without allocating them or waiting for the budget again.
+void RunBatch(const std::string& manifest_filepath, const Mesh& settings, const PeakSearch& search, const bool write_binary_peaks, const bool write_label_map, size_t worker_count, Utilities::MemoryBudget& budget)
+{
+	std::vector<std::pair<std::string, std::string>> jobs(ReadManifest(manifest_filepath));
+	std::atomic<size_t> next_job(0);
+
+	auto worker = [&]()
+	{
+		std::unique_ptr<Mesh> mesh(new Mesh());
+		size_t reserved = 0;
+		for (size_t j = next_job++; j < jobs.size(); j = next_job++)
+		{
+			// Starts from the header settings rather than those the mesh file left from the previous job.
+			mesh->mConversion = settings.mConversion;
+			mesh->loadHeaderFromFile(jobs[j].first.c_str());
+			size_t memory = PeakSearchMemory(*mesh, search);
+			if (memory != reserved)
+			{
+				mesh->freeData();
+				budget.Release(reserved);
+				if (budget.Budget() > 0 && memory > budget.Budget())
+				{
+					std::cout << "Centroid: " << jobs[j].first << " needs " << (memory >> 20) << " MB, more than -memory, and runs on its own." << std::endl;
+				}
+				budget.Acquire(memory);
+				reserved = memory;
+			}
+
+			std::cout << "Centroid: finding the peaks of " << jobs[j].first << "." << std::endl;
+			FindMeshPeaks(*mesh, jobs[j].first.c_str(), search);
+
+			if (write_binary_peaks)
+			{
+				mesh->DumpPeaksBinary(jobs[j].second + ".pkb");
+			}
+			else
+			{
+				std::ofstream writer(jobs[j].second + ".pks");
+				if (writer.is_open())
+				{
+					// The workers already run side by side, so each formats its peaks on its own thread.
+					mesh->DumpPeaks(writer, 1);
+				}
+			}
+			if (write_label_map)
+			{
+				mesh->DumpLabelMap(jobs[j].second + ".lbl");
+			}
+			if (search.watershed)
+			{
+				std::ofstream saddle_writer(jobs[j].second + ".sad");
+				Filetypes::TAPP::SetGlobalPrecision(saddle_writer);
+				mesh->DumpPeakSaddles(saddle_writer);
+			}
+		}
+		mesh.reset();
+		budget.Release(reserved);
+	};
+
+	worker_count = std::min(Utilities::ResolveThreadCount(worker_count), jobs.size());
+	if (worker_count <= 1)
+	{
+		worker();
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	for (size_t w = 0; w < worker_count; ++w)
+	{
+		workers.emplace_back(worker);
+	}
+	for (std::thread& thread : workers)
+	{
+		thread.join();
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	const std::string MESSAGE_PREFIX("Centroid: ");
@@ -208,13 +399,29 @@ int main(int argc, char* argv[])
 	{
 		//cout << MESSAGE_PREFIX << argv[0] << " file.mesh <-npeaks N> <-hdr Header.hdr> < file.pks" << endl;
 		cout << MESSAGE_PREFIX << argv[0] << " file.mesh <-npeaks N> <-hdr Header.hdr> -output file.pks" << endl <<
+			MESSAGE_PREFIX << argv[0] << " -batch manifest <-npeaks N> <-hdr Header.hdr> <-workers N> <-memory MB>" << endl <<
 			"-mzid The mzid file that will be used for the detection of isotopic clusters." << endl <<
 			"-mzxml The mzxml file that will be used for the detection of isotopic clusters." << endl <<
+			"-scans The .scn sidecar written by grid. Replaces -mzxml, without parsing the mzxml file again." << endl <<
 			"-error The error tolerance from 0.0 to 1.0 in regards to the intensity of an isotopic peak." << endl <<
 			"-mz_sigma The m/z tolerance when selecting isotopic peaks. M/z area is (x - sigma * tolerance) to (x + sigma * tolerance)" << endl <<
 			"-rt_sigma The RT tolerance when selecting isotopic peaks. RT area is (x - sigma * tolerance) to (x + sigma * tolerance)" << endl <<
 			"-precursor_window The m/z tolerance in daltons that'll be used when a peak cannot be found at the exact location within the HIT list." << endl <<
-			"-structure Extract clusters that are based entirely on their structure within the MzXML file." << endl;
+			"-structure Extract clusters that are based entirely on their structure within the MzXML file." << endl <<
+			"-band Streams the mesh in bands of N rows instead of loading it whole." << endl <<
+			"-halo The rows loaded above and below each band or tile when exploring peaks (default 16). Larger peaks are redone on their own." << endl <<
+			"-threads The amount of threads used to find peaks, 0 for one per core (default 1). The output does not depend on it." << endl <<
+			"-tile The rows of the mesh in each tile handed to a thread (default 64)." << endl <<
+			"-coarse Only finds peaks above ConversionPeakHeightMin, scanning the mesh where a max-pooled copy with N x N blocks reaches it. Cannot be combined with -band or -threads." << endl <<
+			"-smooth Smooths the mesh before finding peaks, with ConversionSmoothWindow points of ConversionSmoothMethod (Gauss or SavitzkyGolay)." << endl <<
+			"-watershed Segments the whole mesh into peaks in one pass, flooding it from the highest cells down, instead of exploring each peak on its own. Where peaks overlap, each cell goes to one of them. Writes the highest saddle of each peak, and the peak beyond it, to file.sad. Cannot be combined with -band, -coarse, -regions or -candidates." << endl <<
+			"-labels Writes the peak owning each cell of the mesh to file.lbl, as runs of cells per row, so that later steps can look up the peaks of any part of the mesh without finding them again. Cannot be combined with -band, -regions or -candidates." << endl <<
+			"-pkb Writes the peaks as a binary file.pkb instead of file.pks. Warp2D and MetaMatch read either." << endl <<
+			"-regions Only finds peaks inside the regions listed in the file, one per line as: id mzmin mzmax rtmin rtmax. Reads just those parts of the mesh, with -halo cells around them, finds up to N peaks in each and writes the region of each peak to file.roi. Cannot be combined with -band or -coarse." << endl <<
+			"-candidates Keeps the local maxima of the mesh and the peaks explored from them in file, for later runs on the same mesh. These only explore the peaks whose stop height, max(ConversionPeakThreshold * height, ConversionPeakHeightMin), changed, and only load the mesh if there are any. The file is rebuilt when the mesh or -smooth changes. Cannot be combined with -band, -coarse or -regions." << endl <<
+			"-batch Finds the peaks of each mesh listed in the file, one per line as: file.mesh (or file.dat) <output>, writing output.pks, or file.pks when output is left out, along with output.lbl and output.sad under -labels and -watershed. The header is read once, from -hdr or file.hdr, and -output is not needed. Cannot be combined with -mzxml, -scans, -mzid, -structure, -regions or -candidates." << endl <<
+			"-workers The amount of meshes of a -batch processed at once, 0 for one per core (default 1)." << endl <<
+			"-memory The megabytes a -batch may hold for the meshes in process at once, 0 for no limit (default). A mesh that needs more runs on its own." << endl;
         exit(0);
     }
 
@@ -230,12 +437,29 @@ int main(int argc, char* argv[])
     int havenpks = 0;
     int haveheadname = 0;
 
-	std::string		mzxml_filepath, mzid_filepath, output_name;
+	std::string		mzxml_filepath, scans_filepath, mzid_filepath, output_name, regions_filepath, candidates_filepath, batch_filepath;
 	bool			detect_structure_based_clusters = false;
 	unsigned int	isotopic_clustering_mz_sigma_tolerance = 1;
 	unsigned int	isotopic_clustering_rt_sigma_tolerance = 1;
 	double			isotopic_clustering_error_tolerance = 0.1;
 	double			precursor_mz_selection_window = 0.0;
+	int				band_rows = 0;
+	int				halo_rows = 16;
+	int				thread_count = 1;
+	int				tile_rows = 64;
+	bool			write_binary_peaks = false;
+	int				coarse_factor = 0;
+	bool			smooth_mesh = false;
+	bool			watershed = false;
+	bool			write_label_map = false;
+	int				worker_count = 1;
+	size_t			memory_budget_mb = 0;
+
+	// A batch has no mesh of its own, so its options start at argv[1].
+	if (std::string(argv[1]) == "-batch")
+	{
+		narg = 1;
+	}
 
     while (narg < argc) {
         if (!strcmp(argv[narg], "-npeaks")) {
@@ -265,6 +489,14 @@ int main(int argc, char* argv[])
 				mzxml_filepath = argv[narg];
 			}
 		}
+		else if (std::string(argv[narg]) == "-scans")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				scans_filepath = argv[narg];
+			}
+		}
 		else if (std::string(argv[narg]) == "-mzid")
 		{
 			++narg;
@@ -317,6 +549,103 @@ int main(int argc, char* argv[])
 		{
 			detect_structure_based_clusters = true;
 		}
+		else if (std::string(argv[narg]) == "-band")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				band_rows = atoi(argv[narg]);
+			}
+		}
+		else if (std::string(argv[narg]) == "-halo")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				halo_rows = atoi(argv[narg]);
+			}
+		}
+		else if (std::string(argv[narg]) == "-threads")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				thread_count = atoi(argv[narg]);
+			}
+		}
+		else if (std::string(argv[narg]) == "-coarse")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				coarse_factor = atoi(argv[narg]);
+			}
+		}
+		else if (std::string(argv[narg]) == "-smooth")
+		{
+			smooth_mesh = true;
+		}
+		else if (std::string(argv[narg]) == "-watershed")
+		{
+			watershed = true;
+		}
+		else if (std::string(argv[narg]) == "-labels")
+		{
+			write_label_map = true;
+		}
+		else if (std::string(argv[narg]) == "-pkb")
+		{
+			write_binary_peaks = true;
+		}
+		else if (std::string(argv[narg]) == "-regions")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				regions_filepath = argv[narg];
+			}
+		}
+		else if (std::string(argv[narg]) == "-batch")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				batch_filepath = argv[narg];
+				fname = argv[narg];
+			}
+		}
+		else if (std::string(argv[narg]) == "-workers")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				worker_count = atoi(argv[narg]);
+			}
+		}
+		else if (std::string(argv[narg]) == "-memory")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				memory_budget_mb = std::stoull(argv[narg]);
+			}
+		}
+		else if (std::string(argv[narg]) == "-candidates")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				candidates_filepath = argv[narg];
+			}
+		}
+		else if (std::string(argv[narg]) == "-tile")
+		{
+			++narg;
+			if (narg < argc)
+			{
+				tile_rows = atoi(argv[narg]);
+			}
+		}
 		else {
             cerr << "Argument " << argv[narg] << " not recognized. Terminating" << endl;
             exit(-1);
@@ -325,12 +654,48 @@ int main(int argc, char* argv[])
     }
 
 	// Checks input variables. Only output_name for now.
-	if (output_name.empty())
+	if (output_name.empty() && batch_filepath.empty())
 	{
 		std::cout << "Centroid: -output is missing." << std::endl;
 		exit(-1);
 	}
 
+	if (coarse_factor > 0 && (band_rows > 0 || thread_count != 1))
+	{
+		std::cout << "Centroid: -coarse cannot be combined with -band or -threads." << std::endl;
+		exit(-1);
+	}
+
+	if (!regions_filepath.empty() && (band_rows > 0 || coarse_factor > 0))
+	{
+		std::cout << "Centroid: -regions cannot be combined with -band or -coarse." << std::endl;
+		exit(-1);
+	}
+
+	if (watershed && (band_rows > 0 || coarse_factor > 0 || !regions_filepath.empty() || !candidates_filepath.empty()))
+	{
+		std::cout << "Centroid: -watershed cannot be combined with -band, -coarse, -regions or -candidates." << std::endl;
+		exit(-1);
+	}
+
+	if (write_label_map && (band_rows > 0 || !regions_filepath.empty() || !candidates_filepath.empty()))
+	{
+		std::cout << "Centroid: -labels cannot be combined with -band, -regions or -candidates." << std::endl;
+		exit(-1);
+	}
+
+	if (!batch_filepath.empty() && (!mzxml_filepath.empty() || !scans_filepath.empty() || !mzid_filepath.empty() || detect_structure_based_clusters || !regions_filepath.empty() || !candidates_filepath.empty()))
+	{
+		std::cout << "Centroid: -batch cannot be combined with -mzxml, -scans, -mzid, -structure, -regions or -candidates." << std::endl;
+		exit(-1);
+	}
+
+	if (!candidates_filepath.empty() && (band_rows > 0 || coarse_factor > 0 || !regions_filepath.empty()))
+	{
+		std::cout << "Centroid: -candidates cannot be combined with -band, -coarse or -regions." << std::endl;
+		exit(-1);
+	}
+
     LCMSFile mLCMS;
 
     mLCMS.setAttributes("centroid");
@@ -368,29 +733,91 @@ int main(int argc, char* argv[])
     if (mLCMS.mMesh.mConversion.mNPeaksToFind > 0 && !havenpks)  // allow command line to override hdr value
         npeaks = mLCMS.mMesh.mConversion.mNPeaksToFind;
 
-	mLCMS.mMesh.loadFromFile(argv[1]);
+	PeakSearch search{ npeaks, band_rows, halo_rows, thread_count, tile_rows, coarse_factor, smooth_mesh, watershed };
+	if (!batch_filepath.empty())
+	{
+		Utilities::MemoryBudget budget(memory_budget_mb << 20);
+		RunBatch(batch_filepath, mLCMS.mMesh, search, write_binary_peaks, write_label_map, worker_count, budget);
+		return 0;
+	}
+
+	if (!regions_filepath.empty())
+	{
+		std::vector<MeshRegion> regions(Mesh::loadRegions(regions_filepath));
+		mLCMS.mMesh.loadHeaderFromFile(argv[1]);
+		MeshSmoother smoother;
+		if (smooth_mesh)
+		{
+			smoother = MeshSmoother(mLCMS.mMesh.mConversion.mSmoothWindow, mLCMS.mMesh.mConversion.mSmoothMethod, thread_count);
+		}
+		mLCMS.mMesh.FindPeaksInRegions(regions, npeaks, mLCMS.mMesh.mConversion.mPeakThreshold, mLCMS.mMesh.mConversion.mPeakHeightMin, halo_rows, smoother);
+
+		std::ofstream region_writer(output_name + ".roi");
+		mLCMS.mMesh.DumpPeakRegions(region_writer);
+	}
+	else if (!candidates_filepath.empty())
+	{
+		mLCMS.mMesh.loadHeaderFromFile(argv[1]);
+		MeshSmoother smoother;
+		if (smooth_mesh)
+		{
+			smoother = MeshSmoother(mLCMS.mMesh.mConversion.mSmoothWindow, mLCMS.mMesh.mConversion.mSmoothMethod, thread_count);
+		}
+		mLCMS.mMesh.FindPeaksCached(npeaks, mLCMS.mMesh.mConversion.mPeakThreshold, mLCMS.mMesh.mConversion.mPeakHeightMin, candidates_filepath.c_str(), smoother);
+		mLCMS.mMesh.hit.reset();
+	}
+	else
+	{
+		FindMeshPeaks(mLCMS.mMesh, argv[1], search);
+		if (write_label_map)
+		{
+			mLCMS.mMesh.DumpLabelMap(output_name + ".lbl");
+		}
+		if (watershed)
+		{
+			std::ofstream saddle_writer(output_name + ".sad");
+			Filetypes::TAPP::SetGlobalPrecision(saddle_writer);
+			mLCMS.mMesh.DumpPeakSaddles(saddle_writer);
+		}
 
-    mLCMS.mMesh.FindPeaks(npeaks, mLCMS.mMesh.mConversion.mPeakThreshold, mLCMS.mMesh.mConversion.mPeakHeightMin);
+		// The peaks are linked to the scans through their bounding boxes, so the labels are no longer needed.
+		mLCMS.mMesh.hit.reset();
+	}
 
-	std::ofstream writer(output_name + ".pks");
-	if (writer.is_open())
+	if (write_binary_peaks)
+	{
+		mLCMS.mMesh.DumpPeaksBinary(output_name + ".pkb");
+	}
+	else
 	{
-		mLCMS.mMesh.DumpPeaks(writer);
-		writer.close();
+		std::ofstream writer(output_name + ".pks");
+		if (writer.is_open())
+		{
+			mLCMS.mMesh.DumpPeaks(writer, thread_count);
+			writer.close();
+		}
 	}
 
-	if (detect_structure_based_clusters || !mzxml_filepath.empty())
+	if (detect_structure_based_clusters || !mzxml_filepath.empty() || !scans_filepath.empty())
 	{
 		// Initializes the empty variables. The actual contents of these will define the operations the program will use.
 		Filetypes::MzXML::MzXML_File	mzxml_file;
 		Filetypes::Mzid::Mzid_File		mzid_file;
 
-		if (!mzxml_filepath.empty())
+		if (!scans_filepath.empty())
+		{
+			std::cout << MESSAGE_PREFIX << "Reading scan sidecar." << std::endl;
+			mzxml_file = Filetypes::MzXML::ParseScanSidecar(scans_filepath);
+		}
+		else if (!mzxml_filepath.empty())
 		{
-			std::cout << MESSAGE_PREFIX << "Parsing MzXML file." << std::endl;
-			Filetypes::MzXML::MzXML_Parser mz_parser(50240000);
-			mzxml_file = mz_parser.ParseFile(mzxml_filepath);
+			// Only the scan headers are needed, they're read through the scan index when the file has one.
+			std::cout << MESSAGE_PREFIX << "Reading MzXML scan headers." << std::endl;
+			mzxml_file = Filetypes::MzXML::ParseScanHeaders(mzxml_filepath);
+		}
 
+		if (!mzxml_file.filename.empty())
+		{
 			if (!mzid_filepath.empty())
 			{
 				std::cout << MESSAGE_PREFIX << "Parsing Mzid file." << std::endl;
@@ -400,12 +827,12 @@ int main(int argc, char* argv[])
 		}
 
 		std::cout << MESSAGE_PREFIX << "Creating relational tables." << std::endl;
-		std::vector<Filetypes::FileRelations::PeakToEventsRelation>	peak_to_event					= Filetypes::FileRelations::CreatePeakToEventRelation(precursor_mz_selection_window, mLCMS.mMesh, mzxml_file);
+		std::vector<Filetypes::FileRelations::PeakToEventsRelation>	peak_to_event					= Filetypes::FileRelations::CreatePeakToEventRelation(precursor_mz_selection_window, mLCMS.mMesh, mzxml_file, thread_count);
 		std::vector<Filetypes::FileRelations::ScanToIdentificationsRelation> scan_to_identification = Filetypes::FileRelations::CreateScanToIdentificationRelation(mzxml_file, mzid_file);
 
 #ifdef LOAD_MIDAS
 		std::cout << MESSAGE_PREFIX << "Calculating isotopic clusters." << std::endl;
-		MassSpectrometry::Isotope::IsotopicClusterDetector detector(isotopic_clustering_error_tolerance, isotopic_clustering_mz_sigma_tolerance, isotopic_clustering_rt_sigma_tolerance);
+		MassSpectrometry::Isotope::IsotopicClusterDetector detector(isotopic_clustering_error_tolerance, isotopic_clustering_mz_sigma_tolerance, isotopic_clustering_rt_sigma_tolerance, 0, 1, thread_count);
 		std::vector<MassSpectrometry::Isotope::IsotopicCluster> detected_clusters = detector.DetectClusters(peak_to_event, scan_to_identification, detect_structure_based_clusters);
 
 		// Outputs the cluster information.
@@ -0,0 +1,96 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace TAPP::Collections
+{
+	/// <summary>
+	/// Stores strings in large blocks, handing out views that stay valid for the lifetime of the pool, including after it has been moved.
+	/// Strings that repeat can be interned, which stores each distinct string once.
+	/// </summary>
+	class StringPool
+	{
+		public:
+			/// <summary>Initializes an empty pool.</summary>
+			/// <param name="block_size">The amount of characters allocated at once.</param>
+			StringPool(const size_t block_size = 1 << 20) : m_block_size_(block_size), m_block_used_(0)
+			{
+			}
+
+			StringPool(StringPool&& other) = default;
+			StringPool& operator=(StringPool&& other) = default;
+
+			StringPool(const StringPool& other) = delete;
+			StringPool& operator=(const StringPool& other) = delete;
+
+			/// <summary>Copies the string into the pool.</summary>
+			/// <param name="string">The characters to store.</param>
+			/// <returns>A view of the stored copy.</returns>
+			std::string_view Store(const std::string_view string)
+			{
+				if (string.empty())
+				{
+					return std::string_view();
+				}
+
+				if (m_blocks_.empty() || m_block_used_ + string.size() > m_block_sizes_.back())
+				{
+					// Strings longer than a block get a block of their own.
+					m_block_sizes_.push_back(std::max(m_block_size_, string.size()));
+					m_blocks_.emplace_back(new char[m_block_sizes_.back()]);
+					m_block_used_ = 0;
+				}
+
+				char* destination = m_blocks_.back().get() + m_block_used_;
+				std::memcpy(destination, string.data(), string.size());
+				m_block_used_ += string.size();
+
+				return std::string_view(destination, string.size());
+			}
+
+			/// <summary>Returns the pooled copy of the string, storing it if the pool doesn't hold it yet.</summary>
+			/// <param name="string">The characters to intern.</param>
+			/// <returns>A view that compares equal, by address, for every string with the same characters.</returns>
+			std::string_view Intern(const std::string_view string)
+			{
+				auto interned = m_interned_.find(string);
+				if (interned != m_interned_.end())
+				{
+					return *interned;
+				}
+
+				return *m_interned_.insert(Store(string)).first;
+			}
+
+			/// <summary>Releases all strings, invalidating the views handed out so far.</summary>
+			void clear(void)
+			{
+				m_interned_.clear();
+				m_blocks_.clear();
+				m_block_sizes_.clear();
+				m_block_used_ = 0;
+			}
+
+			/// <summary>Returns the amount of distinct interned strings.</summary>
+			size_t size(void) const
+			{
+				return m_interned_.size();
+			}
+
+		private:
+			size_t								m_block_size_;
+			size_t								m_block_used_;
+			std::vector<std::unique_ptr<char[]>>	m_blocks_;
+			std::vector<size_t>					m_block_sizes_;
+			std::unordered_set<std::string_view>	m_interned_;
+	};
+}
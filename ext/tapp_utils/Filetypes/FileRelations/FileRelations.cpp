@@ -10,6 +10,9 @@
 #include <inttypes.h>
 #include <math.h>
 
+#include "Filetypes/FileRelations/PeakIndex.h"
+#include "Utilities/Parallel.hpp"
+
 using namespace TAPP::Filetypes::Mzid;
 using namespace TAPP::Filetypes::MzXML;
 
@@ -46,9 +49,14 @@ namespace TAPP::Filetypes::FileRelations
 
 			if (scan_annotated_identification_results[0].second->scan_id != (size_t)-1)
 			{
+				// Identifications of scans the mzxml information lacks, such as those left out of a scan sidecar, are skipped.
 				for (auto result : scan_annotated_identification_results)
 				{
-					scan_map.find(result.first)->second->identification = result.second;
+					auto scan = scan_map.find(result.first);
+					if (scan != scan_map.end())
+					{
+						scan->second->identification = result.second;
+					}
 				}
 			}
 			else
@@ -62,10 +70,10 @@ namespace TAPP::Filetypes::FileRelations
 
 	// Links peaks to scan events.
 	// If no mzxml file is provided, the vector will only contain the available information from the mesh object.
-	std::vector<PeakToEventsRelation> CreatePeakToEventRelation(const double precursor_mz_window, const Mesh& mesh, MzXML::MzXML_File& mzxml_file)
+	std::vector<PeakToEventsRelation> CreatePeakToEventRelation(const double precursor_mz_window, const Mesh& mesh, MzXML::MzXML_File& mzxml_file, const size_t thread_count)
 	{
 		std::vector<PeakToEventsRelation> peak_to_scans;
-		peak_to_scans.reserve(mesh.peaks.size());
+		peak_to_scans.reserve(mesh.indexed_peaks.size());
 
 		// Creates the initial map of peaks.
 		for (Peak* peak : mesh.indexed_peaks)
@@ -82,103 +90,77 @@ namespace TAPP::Filetypes::FileRelations
 			double rt_min		= mesh.mConversion.mMinRT * time_units;
 			double rt_max		= mesh.mConversion.mMaxRT * time_units;
 
+			// Gathers the events within the scope of the TAPP parameters, so that they can be linked in one pass.
+			std::vector<MzXML::Event*> events;
+			events.reserve(mzxml_file.events.size());
 			size_t out_of_scope = 0;
 			for (std::pair<const size_t, MzXML::Event>& event : mzxml_file.events)
 			{
 				MzXML::Event& event_ref = event.second;
 
-				// Checks if the event is within the scope of the TAPP parameters.
 				if (event_ref.precursor_mz >= mz_min &&
 					event_ref.precursor_mz <= mz_max &&
 					event_ref.spectral_scan->retention_time >= rt_min &&
 					event_ref.spectral_scan->retention_time <= rt_max)
 				{
-					int hit_index = mesh.Index(mesh.mConversion.IndexToMeshX(event_ref.precursor_mz),
-						mesh.mConversion.IndexToMeshY(event_ref.spectral_scan->retention_time / time_units));
-
-					int peak_index = GetHitValue(hit_index, mesh);
-					if (peak_index != 0)
-					{
-						peak_to_scans[peak_index].events.push_back(&event.second);
-					}
-					// If the MZ Tolerance has been defined, look for the nearest peak.
-					else if (precursor_mz_window != 0)
-					{
-						// Calculates the range to analyse.
-						int current_hit_index = mesh.Index(mesh.mConversion.IndexToMeshX(event_ref.precursor_mz - precursor_mz_window),
-							mesh.mConversion.IndexToMeshY(event_ref.spectral_scan->retention_time / time_units));
-						int max_hit_index = mesh.Index(mesh.mConversion.IndexToMeshX(event_ref.precursor_mz + precursor_mz_window),
-							mesh.mConversion.IndexToMeshY(event_ref.spectral_scan->retention_time / time_units));
+					events.push_back(&event_ref);
+				}
+				else
+				{
+					++out_of_scope;
+				}
+			}
 
-						// Maps the peaks within range and selects the one with the highest intensity.
-						std::unordered_set<size_t> peak_index_map;
-						int current_highest_intensity_peak = -1;
+			// Looks up the peak of each event in blocks of events, which only read the index.
+			const size_t block_size = 1024;
+			PeakIndex index(mesh);
+			std::vector<long long> event_peaks(events.size(), -1);
+			std::vector<std::vector<size_t>> event_potential_peaks(events.size());
+			Utilities::ParallelFor((events.size() + block_size - 1) / block_size, thread_count, [&](const size_t block)
+			{
+				for (size_t e = block * block_size; e < std::min(events.size(), (block + 1) * block_size); ++e)
+				{
+					const MzXML::Event& event = *events[e];
+					double rt = event.spectral_scan->retention_time / time_units;
 
-						while (current_hit_index <= max_hit_index)
-						{
-							// Adds a peak to the set, value must be anything other than 0.
-							int potential_peak_index = GetHitValue(current_hit_index, mesh);
-							if (potential_peak_index != 0)
-							{
-								peak_index_map.insert(potential_peak_index);
-
-								// Checks if the newly added peak has an higher intensity than the established peak.
-								if (current_highest_intensity_peak == -1)
-								{
-									current_highest_intensity_peak = potential_peak_index;
-								}
-								else if (peak_to_scans[potential_peak_index].peak->mHeight < peak_to_scans[current_highest_intensity_peak].peak->mHeight)
-								{
-									current_highest_intensity_peak = potential_peak_index;
-								}
-							}
-							++current_hit_index;
-						}
+					event_peaks[e] = index.FindPeak(event.precursor_mz, rt);
 
-						if (current_highest_intensity_peak != -1)
+					// If the MZ Tolerance has been defined, look for the highest peak within it.
+					if (event_peaks[e] == -1 && precursor_mz_window != 0)
+					{
+						event_potential_peaks[e] = index.FindPeaks(event.precursor_mz - precursor_mz_window, event.precursor_mz + precursor_mz_window, rt);
+						for (size_t peak : event_potential_peaks[e])
 						{
-							// Converts the mapping to a vector.
-							std::vector<Peak*> peak_index_vector;
-							peak_index_vector.reserve(peak_index_map.size());
-							for (size_t peak : peak_index_map)
+							if (event_peaks[e] == -1 || mesh.indexed_peaks[peak]->mHeight > mesh.indexed_peaks[event_peaks[e]]->mHeight)
 							{
-								peak_index_vector.push_back(mesh.indexed_peaks[peak]);
+								event_peaks[e] = peak;
 							}
-
-							// Adds the information to the struct.
-							peak_to_scans[current_highest_intensity_peak].events.push_back(&event.second);
-							peak_to_scans[current_highest_intensity_peak].potential_peaks = peak_index_vector;
 						}
 					}
 				}
-				else
+			});
+
+			// Adds the links in the order of the events.
+			for (size_t e = 0; e < events.size(); ++e)
+			{
+				if (event_peaks[e] == -1)
 				{
-					++out_of_scope;
+					continue;
 				}
-			}
-		}
-
-		return peak_to_scans;
-	}
 
-	size_t GetHitValue(const size_t hit_index, const Mesh& mesh)
-	{
-		int peak_index = 0;
-
-		if (!((hit_index < 0 || hit_index >= (mesh.mConversion.mNMZ - 1) * (mesh.mConversion.mNRT - 1))) && // Not outside of the range.
-			mesh.hit[hit_index] != 0) // No hit value.
-		{
-			// Calculates the index for the mesh.indexed_peaks vector.
-			peak_index = sqrt(int64_t(mesh.hit[hit_index]) * int64_t(mesh.hit[hit_index])) - 1;
-
-			// If not present within the peak list.
-			if (peak_index >= mesh.peaks.size())
-			{
-				peak_index = 0;
-				//peak_to_scans[peak_index].events.push_back(&event.second);
+				PeakToEventsRelation& relation = peak_to_scans[event_peaks[e]];
+				relation.events.push_back(events[e]);
+				if (!event_potential_peaks[e].empty())
+				{
+					relation.potential_peaks.clear();
+					for (size_t peak : event_potential_peaks[e])
+					{
+						relation.potential_peaks.push_back(mesh.indexed_peaks[peak]);
+					}
+				}
 			}
 		}
 
-		return peak_index;
+		return peak_to_scans;
 	}
 }
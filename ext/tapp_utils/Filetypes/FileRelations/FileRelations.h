@@ -33,6 +33,6 @@ namespace TAPP::Filetypes::FileRelations
 	};
 
 	std::vector<ScanToIdentificationsRelation> CreateScanToIdentificationRelation(MzXML_File& mzxml_file, Mzid_File& mzid_file);
-	std::vector<PeakToEventsRelation> CreatePeakToEventRelation(const double mz_tolerance, const Mesh& mesh, MzXML_File& mzxml_file);
-	size_t GetHitValue(const size_t hit_index, const Mesh& mesh);
+	// Links each MS2 event to the peak whose bounding box holds its precursor, using the peaks of the mesh but not its hit labels.
+	std::vector<PeakToEventsRelation> CreatePeakToEventRelation(const double mz_tolerance, const Mesh& mesh, MzXML_File& mzxml_file, const size_t thread_count = 1);
 }
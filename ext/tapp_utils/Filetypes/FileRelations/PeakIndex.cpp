@@ -0,0 +1,153 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#include "Filetypes/FileRelations/PeakIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TAPP::Filetypes::FileRelations
+{
+	PeakIndex::PeakIndex(const Mesh& mesh) : m_conversion_(mesh.mConversion), m_cell_width_(1), m_cell_height_(1), m_columns_(1), m_rows_(1)
+	{
+		m_boxes_.reserve(mesh.peaks.size());
+		double width_sum = 0, height_sum = 0;
+		for (size_t p = 0; p < mesh.indexed_peaks.size(); ++p)
+		{
+			const Peak* peak = mesh.indexed_peaks[p];
+			if (!peak)
+			{
+				continue;
+			}
+
+			Box box;
+			box.peak	= p;
+			box.i_min	= std::lround(m_conversion_.WorldToIndexX(peak->mXMin));
+			box.i_max	= std::lround(m_conversion_.WorldToIndexX(peak->mXMax));
+			box.j_min	= std::lround(m_conversion_.MeshToIndexY(peak->mYMin));
+			box.j_max	= std::lround(m_conversion_.MeshToIndexY(peak->mYMax));
+			box.i_apex	= m_conversion_.WorldToIndexX(peak->mXPeak);
+			box.j_apex	= m_conversion_.MeshToIndexY(peak->mYPeak);
+			m_boxes_.push_back(box);
+
+			width_sum	+= box.i_max - box.i_min + 1;
+			height_sum	+= box.j_max - box.j_min + 1;
+		}
+
+		// Sizes the cells so that a typical box overlaps a few of them.
+		if (!m_boxes_.empty())
+		{
+			m_cell_width_	= std::max(4, (int)std::ceil(2 * width_sum / m_boxes_.size()));
+			m_cell_height_	= std::max(4, (int)std::ceil(2 * height_sum / m_boxes_.size()));
+		}
+		m_columns_	= std::max(1, m_conversion_.mNMZ / m_cell_width_ + 1);
+		m_rows_		= std::max(1, m_conversion_.mNRT / m_cell_height_ + 1);
+
+		// Counts the boxes in each cell first, so that the lists can be laid out one after the other.
+		m_cell_offsets_.assign((size_t)m_columns_ * m_rows_ + 1, 0);
+		for (const Box& box : m_boxes_)
+		{
+			for (int row = Row_(box.j_min); row <= Row_(box.j_max); ++row)
+			{
+				for (int column = Column_(box.i_min); column <= Column_(box.i_max); ++column)
+				{
+					++m_cell_offsets_[(size_t)row * m_columns_ + column + 1];
+				}
+			}
+		}
+		for (size_t c = 1; c < m_cell_offsets_.size(); ++c)
+		{
+			m_cell_offsets_[c] += m_cell_offsets_[c - 1];
+		}
+
+		m_cell_boxes_.resize(m_cell_offsets_.back());
+		std::vector<size_t> fill(m_cell_offsets_.begin(), m_cell_offsets_.end() - 1);
+		for (size_t b = 0; b < m_boxes_.size(); ++b)
+		{
+			const Box& box = m_boxes_[b];
+			for (int row = Row_(box.j_min); row <= Row_(box.j_max); ++row)
+			{
+				for (int column = Column_(box.i_min); column <= Column_(box.i_max); ++column)
+				{
+					m_cell_boxes_[fill[(size_t)row * m_columns_ + column]++] = b;
+				}
+			}
+		}
+	}
+
+	long long PeakIndex::FindPeak(const double mz, const double rt) const
+	{
+		double i = m_conversion_.WorldToIndexX(mz);
+		double j = m_conversion_.MeshToIndexY(rt);
+		long cell_i = std::lround(i);
+		long cell_j = std::lround(j);
+		if (cell_i < 0 || cell_i >= m_conversion_.mNMZ || cell_j < 0 || cell_j >= m_conversion_.mNRT)
+		{
+			return -1;
+		}
+
+		long long found = -1;
+		double found_distance = 0;
+		size_t cell = (size_t)Row_(cell_j) * m_columns_ + Column_(cell_i);
+		for (size_t c = m_cell_offsets_[cell]; c < m_cell_offsets_[cell + 1]; ++c)
+		{
+			const Box& box = m_boxes_[m_cell_boxes_[c]];
+			if (cell_i < box.i_min || cell_i > box.i_max || cell_j < box.j_min || cell_j > box.j_max)
+			{
+				continue;
+			}
+
+			double distance = (box.i_apex - i) * (box.i_apex - i) + (box.j_apex - j) * (box.j_apex - j);
+			if (found == -1 || distance < found_distance || (distance == found_distance && box.peak < (size_t)found))
+			{
+				found			= box.peak;
+				found_distance	= distance;
+			}
+		}
+
+		return found;
+	}
+
+	std::vector<size_t> PeakIndex::FindPeaks(const double mz_min, const double mz_max, const double rt) const
+	{
+		std::vector<size_t> found;
+
+		long cell_j = std::lround(m_conversion_.MeshToIndexY(rt));
+		long cell_i_min = std::max(0l, std::lround(m_conversion_.WorldToIndexX(mz_min)));
+		long cell_i_max = std::min((long)m_conversion_.mNMZ - 1, std::lround(m_conversion_.WorldToIndexX(mz_max)));
+		if (cell_j < 0 || cell_j >= m_conversion_.mNRT || cell_i_min > cell_i_max)
+		{
+			return found;
+		}
+
+		for (int column = Column_(cell_i_min); column <= Column_(cell_i_max); ++column)
+		{
+			size_t cell = (size_t)Row_(cell_j) * m_columns_ + column;
+			for (size_t c = m_cell_offsets_[cell]; c < m_cell_offsets_[cell + 1]; ++c)
+			{
+				const Box& box = m_boxes_[m_cell_boxes_[c]];
+				if (cell_j >= box.j_min && cell_j <= box.j_max && cell_i_max >= box.i_min && cell_i_min <= box.i_max)
+				{
+					found.push_back(box.peak);
+				}
+			}
+		}
+
+		// A box spanning several cells is met once for each of them.
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end());
+		return found;
+	}
+
+	int PeakIndex::Column_(const int i) const
+	{
+		return std::min(std::max(i, 0) / m_cell_width_, m_columns_ - 1);
+	}
+
+	int PeakIndex::Row_(const int j) const
+	{
+		return std::min(std::max(j, 0) / m_cell_height_, m_rows_ - 1);
+	}
+}
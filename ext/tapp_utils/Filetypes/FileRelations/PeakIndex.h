@@ -0,0 +1,71 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+#include <vector>
+
+#include "Mesh/Mesh.hpp"
+
+namespace TAPP::Filetypes::FileRelations
+{
+	/*
+		Places the bounding boxes of the peaks of a mesh on a uniform grid in index space, so that the peaks around
+		a point of the mesh can be found without its hit labels. Each grid cell lists the boxes overlapping it, all
+		cells being stored in a single array.
+	*/
+	class PeakIndex
+	{
+		public:
+			/*** Constructors / Destructor **********************************************/
+
+			/// <summary>Indexes the peaks of mesh.indexed_peaks. Entries without a peak are skipped.</summary>
+			/// <param name="mesh">The mesh holding the peaks. Its peaks need to outlive the index.</param>
+			explicit PeakIndex(const Mesh& mesh);
+
+			/*** Functions **************************************************************/
+
+			/// <summary>Finds the peak whose box holds the mesh cell nearest to the passed point.</summary>
+			/// <param name="mz">The m/z of the point.</param>
+			/// <param name="rt">The RT of the point, in mesh units.</param>
+			/// <returns>The position of the peak within mesh.indexed_peaks, the one with the nearest apex if several boxes hold the cell, or -1 if none does.</returns>
+			long long FindPeak(const double mz, const double rt) const;
+
+			/// <summary>Finds the peaks whose boxes hold a mesh cell within the passed m/z range, at the passed RT.</summary>
+			/// <param name="mz_min">The lowest m/z of the range.</param>
+			/// <param name="mz_max">The highest m/z of the range.</param>
+			/// <param name="rt">The RT of the range, in mesh units.</param>
+			/// <returns>The positions of the peaks within mesh.indexed_peaks, in ascending order.</returns>
+			std::vector<size_t> FindPeaks(const double mz_min, const double mz_max, const double rt) const;
+
+		private:
+			/*** Variables **************************************************************/
+
+			// The box of a peak in mesh cells, and the cell of its apex.
+			struct Box
+			{
+				size_t	peak;
+				int		i_min;
+				int		i_max;
+				int		j_min;
+				int		j_max;
+				double	i_apex;
+				double	j_apex;
+			};
+
+			const ConversionSpecs&	m_conversion_;
+			std::vector<Box>		m_boxes_;
+			std::vector<size_t>		m_cell_offsets_;
+			std::vector<size_t>		m_cell_boxes_;
+			int						m_cell_width_;
+			int						m_cell_height_;
+			int						m_columns_;
+			int						m_rows_;
+
+			/*** Functions **************************************************************/
+
+			int Column_(const int i) const;
+			int Row_(const int j) const;
+	};
+}
@@ -27,7 +27,7 @@ namespace TAPP::Filetypes::MzXML
 			auto this_event = events.find(other_event.first);
 
 			this_event->second.spectral_scan	= &scans.find(other_event.second.spectral_scan->scan_id)->second;
-			this_event->second.precursor_scan	= &scans.find(other_event.second.precursor_scan->scan_id)->second;
+			this_event->second.precursor_scan	= other_event.second.precursor_scan ? &scans.find(other_event.second.precursor_scan->scan_id)->second : nullptr;
 		}
 	}
 
@@ -50,7 +50,7 @@ namespace TAPP::Filetypes::MzXML
 			auto this_event = events.find(other_event.first);
 
 			this_event->second.spectral_scan = &scans.find(other_event.second.spectral_scan->scan_id)->second;
-			this_event->second.precursor_scan = &scans.find(other_event.second.precursor_scan->scan_id)->second;
+			this_event->second.precursor_scan = other_event.second.precursor_scan ? &scans.find(other_event.second.precursor_scan->scan_id)->second : nullptr;
 		}
 
 		return *this;
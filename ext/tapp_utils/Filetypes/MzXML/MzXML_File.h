@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <string>
 #include <unordered_map>
 
 namespace TAPP::Filetypes::MzXML
@@ -38,6 +40,7 @@ namespace TAPP::Filetypes::MzXML
 		unsigned char	precursor_charge_state;
 		double			precursor_intensity;
 		double			precursor_mz;
+		double			isolation_window;
 	};
 
 	/*	MzXML_File
@@ -42,65 +42,82 @@ namespace TAPP::Filetypes::MzXML
 
 	/*** Private Functions ******************************************************/
 
-	// Parses the scan information.
+	// Parses the scan information. Fields are read through views into the buffer, so no strings are created per attribute.
 	void MzXML_Parser::ParseScans_(std::string& buffer)
 	{
+		std::string_view view(buffer);
+
 		// Acquires the initial positions for the parsing.
 		size_t scan_previous = 0;
-		size_t scan_start = buffer.find("<scan");
-		size_t scan_end = buffer.find("<peaks", scan_start);
+		size_t scan_start = view.find("<scan");
+		size_t scan_end = view.find("<peaks", scan_start);
 
 		// Only parses complete pieces of data.
-		while (scan_start != std::string::npos && scan_end != std::string::npos)
+		while (scan_start != std::string_view::npos && scan_end != std::string_view::npos)
 		{
-			// Locates and parses the scan number.
-			size_t scan_number = std::stoi(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("num", scan_start)));
-
-			// Parses, creates and inserts the Scan object. It then checks if an Event object needs to be created.
-			ParseEvent_
-			(
-				m_return_object$.scans.insert({ scan_number,
-				{
-					scan_number,
-					(size_t)std::stoi(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("peaksCount", scan_start) + 10)),
-					(unsigned char)std::stoi(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("msLevel", scan_start) + 7)),
-					GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("polarity", scan_start) + 8)[0],
-					std::stod(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("lowMz", scan_start) + 5)),
-					std::stod(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("highMz", scan_start) + 6)),
-					std::stod(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("basePeakMz", scan_start) + 10)),
-					std::stod(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("basePeakIntensity", scan_start) + 17)),
-					std::stod(GetEmbeddedCharacters(buffer, 'T', 'S', buffer.find("retentionTime", scan_start) + 13)),
-					std::stod(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("totIonCurrent", scan_start) + 13))
-				} }).first->second,
-				buffer,
-				scan_start,
-				scan_end
-			);
+			ParseScanHeader(m_return_object$, view.substr(scan_start, scan_end - scan_start));
 
 			scan_previous = scan_end;
-			scan_start = buffer.find("<scan", scan_end);
-			scan_end = buffer.find("<peaks", scan_start);
+			scan_start = view.find("<scan", scan_end);
+			scan_end = view.find("<peaks", scan_start);
 		}
 
-		// Trims the buffer so it only includes unparsed characters.
-		buffer = buffer.substr(buffer.find('<', scan_previous));
+		// Trims the buffer in place so it only includes unparsed characters.
+		buffer.erase(0, view.find('<', scan_previous));
 	}
 
-	// Parses the event information.
-	void MzXML_Parser::ParseEvent_(Scan& scan, std::string& buffer, size_t start_position, size_t end_position)
+	/*** Functions **************************************************************/
+
+	void ParseScanHeader(MzXML_File& file, std::string_view scan_header)
 	{
+		std::string_view scan_tag(scan_header.substr(0, scan_header.find('>')));
+
+		// The retention time is a duration in seconds, written as PT<seconds>S.
+		std::string_view polarity(GetAttributeView(scan_tag, "polarity"));
+		std::string_view retention_time(GetEmbeddedView(GetAttributeView(scan_tag, "retentionTime"), 'T', 'S'));
+
+		// Parses, creates and inserts the Scan object.
+		size_t scan_number = ParseNumber<size_t>(GetAttributeView(scan_tag, "num"));
+		Scan& scan = file.scans.insert({ scan_number,
+		{
+			scan_number,
+			ParseNumber<size_t>(GetAttributeView(scan_tag, "peaksCount")),
+			(unsigned char)ParseNumber<int>(GetAttributeView(scan_tag, "msLevel")),
+			polarity.empty() ? '\0' : polarity[0],
+			ParseNumber<double>(GetAttributeView(scan_tag, "lowMz")),
+			ParseNumber<double>(GetAttributeView(scan_tag, "highMz")),
+			ParseNumber<double>(GetAttributeView(scan_tag, "basePeakMz")),
+			ParseNumber<double>(GetAttributeView(scan_tag, "basePeakIntensity")),
+			ParseNumber<double>(retention_time),
+			ParseNumber<double>(GetAttributeView(scan_tag, "totIonCurrent"))
+		} }).first->second;
+
 		// Checks if event information is available.
-		size_t precursor_scan_position = buffer.find("precursorScanNum", start_position);
-		if (precursor_scan_position < end_position && precursor_scan_position != std::string::npos)
+		size_t precursor_position = scan_header.find("<precursorMz");
+		if (precursor_position == std::string_view::npos)
 		{
-			m_return_object$.events.insert({ scan.scan_id,
-			{
-				&scan,
-				&m_return_object$.scans.find(std::stoi(GetEmbeddedCharacters(buffer, m_brackets_, precursor_scan_position)))->second,
-				(unsigned char)std::stoi(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("precursorCharge", precursor_scan_position))),
-				atof(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("precursorIntensity", precursor_scan_position)).c_str()),
-				atof(GetEmbeddedCharacters(buffer, '>', '<', precursor_scan_position).c_str())
-			}});
+			return;
 		}
+
+		size_t precursor_tag_end = scan_header.find('>', precursor_position);
+		std::string_view precursor_tag(scan_header.substr(precursor_position, precursor_tag_end - precursor_position));
+		std::string_view precursor_scan_number(GetAttributeView(precursor_tag, "precursorScanNum"));
+		if (precursor_scan_number.empty() || precursor_tag_end == std::string_view::npos)
+		{
+			return;
+		}
+
+		// The precursor scan precedes the event in the file, it's left empty if it doesn't.
+		auto precursor_scan = file.scans.find(ParseNumber<size_t>(precursor_scan_number));
+
+		file.events.insert({ scan.scan_id,
+		{
+			&scan,
+			precursor_scan == file.scans.end() ? nullptr : &precursor_scan->second,
+			(unsigned char)ParseNumber<int>(GetAttributeView(precursor_tag, "precursorCharge")),
+			ParseNumber<double>(GetAttributeView(precursor_tag, "precursorIntensity")),
+			ParseNumber<double>(GetEmbeddedView(scan_header, '>', '<', precursor_tag_end)),
+			ParseNumber<double>(GetAttributeView(precursor_tag, "windowWideness"))
+		}});
 	}
 }
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "Filetypes/MzXML/MzXML_File.h"
@@ -14,8 +15,6 @@
 
 namespace TAPP::Filetypes::MzXML
 {
-	// TODO: Improve speed by adding offsets to the string finds.
-
 	class MzXML_Parser : public IO::StreamParser<MzXML_File>
 	{
 		public:
@@ -42,13 +41,12 @@ namespace TAPP::Filetypes::MzXML
 			void Setup$(const std::string& filepath);
 
 		private:
-			/*** Variables **************************************************************/
-
-			// Constant for the bracket type.
-			const static Utilities::StringManipulation::BracketType	m_brackets_ = Utilities::StringManipulation::QOUTES;
-
 			/*** Functions **************************************************************/
 			void ParseScans_(std::string& buffer);
-			void ParseEvent_(Scan& scan, std::string& buffer, size_t start_position, size_t end_position);
 	};
+
+	/// <summary>Parses a scan, and its MS/MS event if it has one, from the part of the scan element that precedes its peaks.</summary>
+	/// <param name="file">The file receiving the scan. The precursor scan of the event is looked up among the scans parsed before.</param>
+	/// <param name="scan_header">The scan element up to its peaks element.</param>
+	void ParseScanHeader(MzXML_File& file, std::string_view scan_header);
 }
@@ -0,0 +1,128 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#include "Filetypes/MzXML/ScanIndex.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string_view>
+
+#include "Exceptions/FileAccessError.h"
+#include "Exceptions/FormatError.h"
+#include "Filetypes/MzXML/MzXML_Parser.h"
+#include "Utilities/StringManipulation.h"
+
+using namespace TAPP::Utilities::StringManipulation;
+
+namespace TAPP::Filetypes::MzXML
+{
+	// The indexOffset element is searched for within this many bytes from the end of the file.
+	const static uint64_t INDEX_TAIL_SIZE	= 4096;
+	// The first read of a scan, which is doubled until it reaches the peaks element.
+	const static uint64_t SCAN_HEADER_BLOCK	= 1024;
+
+	// Reads up to size bytes from the offset, stopping at the end of the file.
+	static std::string ReadBlock(std::ifstream& in, const uint64_t offset, uint64_t size, const uint64_t file_size)
+	{
+		size = std::min(size, file_size - std::min(offset, file_size));
+		std::string block(size, '\0');
+		in.clear();
+		in.seekg(offset);
+		in.read(&block[0], size);
+		block.resize(in.gcount());
+		return block;
+	}
+
+	std::vector<uint64_t> ReadScanIndex(const std::string& filepath)
+	{
+		std::ifstream in(filepath, std::ios::in | std::ios::binary);
+		if (!in.is_open())
+		{
+			throw Exceptions::FileAccessError("Unable to open mzXML file: " + filepath);
+		}
+		in.seekg(0, std::ios::end);
+		const uint64_t file_size = in.tellg();
+
+		std::string tail(ReadBlock(in, file_size - std::min(file_size, INDEX_TAIL_SIZE), INDEX_TAIL_SIZE, file_size));
+		size_t index_offset_position = tail.rfind("<indexOffset");
+		if (index_offset_position == std::string::npos)
+		{
+			return std::vector<uint64_t>();
+		}
+
+		// The index lies between the offset and the indexOffset element, so only that part is read.
+		uint64_t index_offset = ParseNumber<uint64_t>(GetEmbeddedView(tail, '>', '<', index_offset_position));
+		uint64_t index_offset_element = file_size - tail.size() + index_offset_position;
+		if (index_offset == 0 || index_offset >= index_offset_element)
+		{
+			throw Exceptions::FormatError("The index offset of the mzXML file doesn't precede its indexOffset element: " + filepath);
+		}
+
+		if (ReadBlock(in, index_offset, 6, file_size) != "<index")
+		{
+			throw Exceptions::FormatError("The index offset doesn't point at the index of the mzXML file: " + filepath);
+		}
+		std::string index(ReadBlock(in, index_offset, index_offset_element - index_offset, file_size));
+
+		// The scan index comes first, other indices follow it.
+		size_t index_end = index.find("</index>");
+		if (index_end == std::string::npos)
+		{
+			throw Exceptions::FormatError("The index of the mzXML file is truncated: " + filepath);
+		}
+
+		std::vector<uint64_t> offsets;
+		for (size_t position = index.find("<offset"); position < index_end; position = index.find("<offset", position + 1))
+		{
+			offsets.push_back(ParseNumber<uint64_t>(GetEmbeddedView(index, '>', '<', position)));
+		}
+
+		return offsets;
+	}
+
+	MzXML_File ParseScanHeaders(const std::string& filepath)
+	{
+		std::vector<uint64_t> offsets(ReadScanIndex(filepath));
+		if (offsets.empty())
+		{
+			MzXML_Parser parser;
+			return parser.ParseFile(filepath);
+		}
+
+		std::ifstream in(filepath, std::ios::in | std::ios::binary);
+		if (!in.is_open())
+		{
+			throw Exceptions::FileAccessError("Unable to open mzXML file: " + filepath);
+		}
+		in.seekg(0, std::ios::end);
+		const uint64_t file_size = in.tellg();
+
+		MzXML_File file;
+		file.filename = FilepathToFilename(filepath);
+		file.scans.reserve(offsets.size());
+
+		// Reads the scans in file order, so that precursor scans are parsed before their events.
+		std::sort(offsets.begin(), offsets.end());
+		for (uint64_t offset : offsets)
+		{
+			std::string header(ReadBlock(in, offset, SCAN_HEADER_BLOCK, file_size));
+			size_t peaks_position = header.find("<peaks");
+			while (peaks_position == std::string::npos && offset + header.size() < file_size)
+			{
+				header += ReadBlock(in, offset + header.size(), header.size(), file_size);
+				peaks_position = header.find("<peaks");
+			}
+
+			if (header.compare(0, 5, "<scan") != 0 || peaks_position == std::string::npos)
+			{
+				throw Exceptions::FormatError("The scan index doesn't match the mzXML file: " + filepath);
+			}
+
+			ParseScanHeader(file, std::string_view(header).substr(0, peaks_position));
+		}
+
+		return file;
+	}
+}
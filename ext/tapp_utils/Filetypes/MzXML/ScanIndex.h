@@ -0,0 +1,30 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Filetypes/MzXML/MzXML_File.h"
+
+/*
+	An indexed mzXML file ends with an index holding the byte offset of every scan element, and an indexOffset element
+	pointing at the index. The scan attributes and the precursorMz element precede the base64 peaks of a scan, so the
+	scans and MS/MS events can be read by seeking to each scan and reading until its peaks, leaving the peaks unread.
+*/
+
+namespace TAPP::Filetypes::MzXML
+{
+	/// <summary>Reads the scan offsets from the index of a mzXML file.</summary>
+	/// <param name="filepath">The filepath of the mzXML file to read.</param>
+	/// <returns>The byte offsets of the scan elements in the order of the index, or an empty vector if the file isn't indexed.</returns>
+	std::vector<uint64_t> ReadScanIndex(const std::string& filepath);
+
+	/// <summary>Reads the scans and MS/MS events of a mzXML file, without their peaks. Files without an index are parsed in full.</summary>
+	/// <param name="filepath">The filepath of the mzXML file to read.</param>
+	/// <returns>A MzXML_File holding the scan and event information present within the file.</returns>
+	MzXML_File ParseScanHeaders(const std::string& filepath);
+}
@@ -0,0 +1,141 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#include "Filetypes/MzXML/ScanSidecar.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "Exceptions/FileAccessError.h"
+#include "Exceptions/FormatError.h"
+#include "Mesh/FSUtil.h"
+
+namespace TAPP::Filetypes::MzXML
+{
+	// Identifies the file and its layout. The records are stored in platform endianness.
+	const static char		SIDECAR_MAGIC[4]	= { 'T', 'S', 'C', 'N' };
+	const static uint32_t	SIDECAR_VERSION		= 1;
+
+	ScanSidecarRecord CreateScanSidecarRecord(const Scan& scan, const Event* event)
+	{
+		ScanSidecarRecord record{ (uint32_t)scan.scan_id, 0, scan.ms_level, 0, scan.retention_time, 0, 0, 0 };
+		if (event)
+		{
+			record.precursor_scan_id		= event->precursor_scan ? event->precursor_scan->scan_id : 0;
+			record.precursor_charge_state	= event->precursor_charge_state;
+			record.precursor_mz				= event->precursor_mz;
+			record.precursor_intensity		= event->precursor_intensity;
+			record.isolation_window			= event->isolation_window;
+		}
+		return record;
+	}
+
+	void WriteScanSidecar(const std::string& filepath, const std::string& source_filename, const std::vector<ScanSidecarRecord>& records)
+	{
+		std::ofstream out(filepath, std::ios::out | std::ios::binary);
+		if (!out.is_open())
+		{
+			throw Exceptions::FileAccessError("Unable to open scan sidecar for writing: " + filepath);
+		}
+
+		uint32_t little_endian		= FS_LITTLEENDIAN;
+		uint32_t record_size		= sizeof(ScanSidecarRecord);
+		uint32_t filename_length	= source_filename.size();
+		uint64_t record_count		= records.size();
+
+		out.write(SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+		out.write((const char*)&SIDECAR_VERSION, sizeof(SIDECAR_VERSION));
+		out.write((const char*)&little_endian, sizeof(little_endian));
+		out.write((const char*)&record_size, sizeof(record_size));
+		out.write((const char*)&filename_length, sizeof(filename_length));
+		out.write(source_filename.data(), filename_length);
+		out.write((const char*)&record_count, sizeof(record_count));
+		out.write((const char*)records.data(), record_count * sizeof(ScanSidecarRecord));
+	}
+
+	std::vector<ScanSidecarRecord> ReadScanSidecar(const std::string& filepath, std::string& source_filename)
+	{
+		std::ifstream in(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+		if (!in.is_open())
+		{
+			throw Exceptions::FileAccessError("Unable to open scan sidecar: " + filepath);
+		}
+		const uint64_t file_size = in.tellg();
+		in.seekg(0);
+
+		char		magic[4];
+		uint32_t	version, little_endian, record_size, filename_length;
+		uint64_t	record_count;
+
+		in.read(magic, sizeof(magic));
+		in.read((char*)&version, sizeof(version));
+		in.read((char*)&little_endian, sizeof(little_endian));
+		in.read((char*)&record_size, sizeof(record_size));
+		if (!in || memcmp(magic, SIDECAR_MAGIC, sizeof(magic)) != 0 || version != SIDECAR_VERSION)
+		{
+			throw Exceptions::FormatError("Not a scan sidecar file: " + filepath);
+		}
+		if (little_endian != FS_LITTLEENDIAN || record_size != sizeof(ScanSidecarRecord))
+		{
+			throw Exceptions::FormatError("Scan sidecar was written on an incompatible platform: " + filepath);
+		}
+
+		// The lengths are checked against the rest of the file before anything is allocated for them.
+		in.read((char*)&filename_length, sizeof(filename_length));
+		if (!in || filename_length > file_size - (uint64_t)in.tellg())
+		{
+			throw Exceptions::FormatError("Scan sidecar is truncated: " + filepath);
+		}
+		source_filename.resize(filename_length);
+		in.read(&source_filename[0], filename_length);
+		in.read((char*)&record_count, sizeof(record_count));
+		if (!in || record_count > (file_size - (uint64_t)in.tellg()) / sizeof(ScanSidecarRecord))
+		{
+			throw Exceptions::FormatError("Scan sidecar is truncated: " + filepath);
+		}
+
+		std::vector<ScanSidecarRecord> records(record_count);
+		in.read((char*)records.data(), record_count * sizeof(ScanSidecarRecord));
+		if (!in)
+		{
+			throw Exceptions::FormatError("Scan sidecar is truncated: " + filepath);
+		}
+
+		return records;
+	}
+
+	MzXML_File ParseScanSidecar(const std::string& filepath)
+	{
+		MzXML_File file;
+		std::vector<ScanSidecarRecord> records(ReadScanSidecar(filepath, file.filename));
+
+		// Creates the scans first, so that the events can refer to them.
+		file.scans.reserve(records.size());
+		for (const ScanSidecarRecord& record : records)
+		{
+			file.scans.insert({ record.scan_id, { record.scan_id, 0, record.ms_level, 0, 0, 0, 0, 0, record.retention_time, 0 } });
+		}
+
+		for (const ScanSidecarRecord& record : records)
+		{
+			if (record.ms_level > 1 && record.precursor_mz > 0)
+			{
+				auto precursor_scan = file.scans.find(record.precursor_scan_id);
+
+				file.events.insert({ record.scan_id,
+				{
+					&file.scans.find(record.scan_id)->second,
+					precursor_scan == file.scans.end() ? nullptr : &precursor_scan->second,
+					record.precursor_charge_state,
+					record.precursor_intensity,
+					record.precursor_mz,
+					record.isolation_window
+				} });
+			}
+		}
+
+		return file;
+	}
+}
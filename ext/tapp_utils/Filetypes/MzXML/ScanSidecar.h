@@ -0,0 +1,49 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Filetypes/MzXML/MzXML_File.h"
+
+namespace TAPP::Filetypes::MzXML
+{
+	/// <summary>Resembles the structure of a scan sidecar (.scn) record, one per scan encountered by grid.</summary>
+	struct ScanSidecarRecord
+	{
+		uint32_t	scan_id;
+		uint32_t	precursor_scan_id;
+		uint8_t		ms_level;
+		uint8_t		precursor_charge_state;
+		double		retention_time;
+		double		precursor_mz;
+		double		precursor_intensity;
+		double		isolation_window;
+	};
+
+	/// <summary>Creates the sidecar record of a scan.</summary>
+	/// <param name="scan">The scan.</param>
+	/// <param name="event">The MS/MS event of the scan, or nullptr if it has none.</param>
+	ScanSidecarRecord CreateScanSidecarRecord(const Scan& scan, const Event* event);
+
+	/// <summary>Writes scan sidecar records into a binary file.</summary>
+	/// <param name="filepath">The filepath of the sidecar file to write.</param>
+	/// <param name="source_filename">The filename of the mzXML file the records were extracted from.</param>
+	/// <param name="records">The records to write into the file.</param>
+	void WriteScanSidecar(const std::string& filepath, const std::string& source_filename, const std::vector<ScanSidecarRecord>& records);
+
+	/// <summary>Reads the scan sidecar records from a binary file.</summary>
+	/// <param name="filepath">The filepath of the sidecar file to read.</param>
+	/// <param name="source_filename">Receives the filename of the mzXML file the records were extracted from.</param>
+	/// <returns>A vector containing all the records stored in the file.</returns>
+	std::vector<ScanSidecarRecord> ReadScanSidecar(const std::string& filepath, std::string& source_filename);
+
+	/// <summary>Reads a scan sidecar file and reconstructs the scans and MS/MS events it describes.</summary>
+	/// <param name="filepath">The filepath of the sidecar file to read.</param>
+	/// <returns>A MzXML_File holding the scan and event information present within the sidecar.</returns>
+	MzXML_File ParseScanSidecar(const std::string& filepath);
+}
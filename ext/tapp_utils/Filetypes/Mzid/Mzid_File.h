@@ -5,12 +5,15 @@
 
 #pragma once
 
-#include <functional>
+#include <deque>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "Collections/StringPool.hpp"
+
 // Todo: Rename sequence to fasta or database sequence.
 
 namespace TAPP::Filetypes::Mzid // C++ 17 will provide a better way for nesting. Example: Data::Mzid
@@ -26,29 +29,30 @@ namespace TAPP::Filetypes::Mzid // C++ 17 will provide a better way for nesting.
 		unsigned short								accession;
 		unsigned short								location;
 		double										monoisotopicMassDelta;
-		std::string*								cv_reference;
-		std::string*								name;
+		std::string_view							cv_reference;
+		std::string_view							name;
 		char										residues;
 	};
 
 	struct Peptide
 	{
-		std::string									id;
-		std::string									sequence;
+		std::string_view							id;
+		std::string_view							sequence;
 		std::vector<Modification>					modifications;
 	};
 
 	struct Sequence
 	{
-		std::string									description;
-		std::string									id;
+		std::string_view							accession;
+		std::string_view							description;
+		std::string_view							id;
 	};
 
 	struct PeptideEvidence
 	{
 		unsigned short								end;
 		unsigned short								start;
-		std::string									id;
+		std::string_view							id;
 		bool										is_decoy;
 		char										post;
 		char										pre;
@@ -59,7 +63,7 @@ namespace TAPP::Filetypes::Mzid // C++ 17 will provide a better way for nesting.
 	struct Iontype
 	{
 		std::string									indices;
-		std::string									name;
+		std::string_view							name;
 		unsigned char								charge;
 		std::vector<double>							mz_values;
 		std::vector<double>							intensity_values;
@@ -68,7 +72,7 @@ namespace TAPP::Filetypes::Mzid // C++ 17 will provide a better way for nesting.
 
 	struct SpectrumIdentificationItem
 	{
-		std::string									id;
+		std::string_view							id;
 		unsigned char								chargestate;
 		double										calculated_mz;
 		double										experimental_mz;
@@ -82,7 +86,7 @@ namespace TAPP::Filetypes::Mzid // C++ 17 will provide a better way for nesting.
 
 	struct SpectrumIdentificationResult
 	{
-		std::string									id;
+		std::string_view							id;
 		size_t										index;
 		double										retention_time;
 		size_t										scan_id;
@@ -91,7 +95,7 @@ namespace TAPP::Filetypes::Mzid // C++ 17 will provide a better way for nesting.
 
 	struct ProteinHypothesis
 	{
-		std::string									id;
+		std::string_view							id;
 		bool										passed_threshold;
 		PeptideEvidence*							evidence;
 		Sequence*									sequence;
@@ -100,36 +104,40 @@ namespace TAPP::Filetypes::Mzid // C++ 17 will provide a better way for nesting.
 
 	struct ProteinGroup
 	{
-		std::string									id;
+		std::string_view							id;
 		std::vector<CV_Parameter>					cv_parameters;
 		std::vector<ProteinHypothesis>				hypotheses;
 	};
 
 	/*** Mzid File Definition ***************************************************/
 
+	/*
+		The records are kept in deques, which allocate them in blocks and never move them, so that the records can point
+		at each other. Their strings point into the string pool: identifiers are stored once per record, while accessions,
+		sequences and names that repeat throughout a file are interned. The file can therefore be moved, but not copied.
+	*/
 	struct Mzid_File
 	{
-		typedef std::vector<std::pair<size_t, SpectrumIdentificationResult*>>		ScanAnnotatedIdentificationResults; // std::vector<std::pair<size_t, SpectrumIdentificationResult*>>
+		typedef std::vector<std::pair<size_t, SpectrumIdentificationResult*>>				ScanAnnotatedIdentificationResults; // std::vector<std::pair<size_t, SpectrumIdentificationResult*>>
 
 		Mzid_File(void);								// Default Constructor
-		Mzid_File(const Mzid_File& other);				// Copy Constructor
+		Mzid_File(const Mzid_File& other) = delete;		// Copy Constructor
 		Mzid_File(Mzid_File&& other);					// Move Constructor
 		~Mzid_File(void);								// Destructor
 
-		Mzid_File& operator=(const Mzid_File& other);	// Copy Assignment
+		Mzid_File& operator=(const Mzid_File& other) = delete;	// Copy Assignment
 		Mzid_File& operator=(Mzid_File&& other);		// Move Assignment
 
-		std::string																	filename;
-		std::unordered_map<size_t, std::string>										cv_references;
-		std::unordered_map<std::string, std::vector<SpectrumIdentificationResult*>>	file_sorted_identifications;
-		std::unordered_map<size_t, SpectrumIdentificationItem>						identification_items;
-		std::unordered_map<size_t, SpectrumIdentificationResult>					identification_results;
-		std::unordered_map<size_t, std::string>										modification_names;
-		std::unordered_map<size_t, Peptide>											peptides;
-		std::unordered_map<size_t, PeptideEvidence>									peptide_evidence;
-		std::unordered_map<size_t, ProteinGroup>									protein_groups;
-		std::unordered_map<size_t, Sequence>										sequences;
-		std::unordered_set<std::string>												cv_param_names;
+		std::string																			filename;
+		Collections::StringPool																strings;
+		std::unordered_map<std::string_view, std::vector<SpectrumIdentificationResult*>>	file_sorted_identifications;
+		std::deque<SpectrumIdentificationItem>												identification_items;
+		std::deque<SpectrumIdentificationResult>											identification_results;
+		std::deque<Peptide>																	peptides;
+		std::deque<PeptideEvidence>															peptide_evidence;
+		std::deque<ProteinGroup>															protein_groups;
+		std::deque<Sequence>																sequences;
+		std::unordered_set<std::string>														cv_param_names;
 
 		ScanAnnotatedIdentificationResults GetScanAnnotatedIdentificationResults(const std::string& filename);
 	};
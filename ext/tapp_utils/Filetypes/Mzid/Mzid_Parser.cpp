@@ -5,8 +5,12 @@
 
 #include "Filetypes/Mzid/Mzid_Parser.h"
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
+#include "Utilities/StringManipulation.h"
+
 using namespace TAPP::Utilities::StringManipulation;
 
 namespace TAPP::Filetypes::Mzid
@@ -14,7 +18,7 @@ namespace TAPP::Filetypes::Mzid
 	/*** Constructors ***********************************************************/
 
 	// Standard Constructor
-	Mzid_Parser::Mzid_Parser(bool allow_file_errors, size_t buffer_size) : StreamParser(buffer_size), m_ignore_file_errors_(allow_file_errors)
+	Mzid_Parser::Mzid_Parser(bool allow_file_errors, size_t buffer_size) : StreamParser(buffer_size), m_ignore_file_errors_(allow_file_errors), m_record_valid_(true)
 	{
 	}
 
@@ -22,20 +26,86 @@ namespace TAPP::Filetypes::Mzid
 
 	void Mzid_Parser::Closure$(void)
 	{
+		// The lookups point into the file, which is handed over after this.
+		m_sequence_ids_.clear();
+		m_peptide_ids_.clear();
+		m_evidence_ids_.clear();
+		m_item_ids_.clear();
+		m_cv_param_names_.clear();
+		m_items_.clear();
 	}
 
 	void Mzid_Parser::ParseString$(std::string& buffer)
 	{
 		try
 		{
-			switch (m_current_stage_)
+			std::string_view view(buffer);
+			size_t consumed = 0;
+
+			for (size_t tag_start = view.find('<'); tag_start != std::string_view::npos; tag_start = view.find('<', consumed))
 			{
-				case SEQUENCES:			if (ParseSequences_(buffer)) { m_current_stage_ = PEPTIDES; } break;
-				case PEPTIDES:			if (ParsePeptides_(buffer)) { m_current_stage_ = EVIDENCE; } break;
-				case EVIDENCE:			if (ParseEvidences_(buffer)) { m_current_stage_ = IDENTIFICATIONS; } break;
-				case IDENTIFICATIONS:	if (ParseSpectrumIdentificationResults_(buffer)) { m_current_stage_ = PROTEIN; } break;
-				case PROTEIN:			if (ParseProteinGroup_(buffer)) { m_current_stage_ = END; } break;
-				case END:				buffer.clear(); break;
+				// Comments may hold any character, and end with their own marker.
+				size_t tag_end;
+				if (view.compare(tag_start, 4, "<!--") == 0)
+				{
+					tag_end = view.find("-->", tag_start + 4);
+					if (tag_end == std::string_view::npos)
+					{
+						break;
+					}
+					consumed = tag_end + 3;
+					continue;
+				}
+
+				// Finds the end of the tag, skipping quoted attribute values as these may contain a '>'.
+				const char* end = view.data() + view.size();
+				const char* character = view.data() + tag_start + 1;
+				for (; character < end && *character != '>'; ++character)
+				{
+					if (*character == '"' || *character == '\'')
+					{
+						character = (const char*)std::memchr(character + 1, *character, end - character - 1);
+						if (!character)
+						{
+							character = end;
+							break;
+						}
+					}
+				}
+				if (character >= end)
+				{
+					break;
+				}
+				tag_end = character - view.data();
+
+				std::string_view text(view.substr(consumed, tag_start - consumed));
+				std::string_view tag(view.substr(tag_start + 1, tag_end - tag_start - 1));
+				consumed = tag_end + 1;
+
+				if (tag.empty() || tag[0] == '?' || tag[0] == '!')
+				{
+					continue;
+				}
+
+				if (tag[0] == '/')
+				{
+					EndElement_(tag.substr(1, tag.find_first_of(" \t\r\n", 1) - 1), text);
+					continue;
+				}
+
+				std::string_view name(tag.substr(0, tag.find_first_of(" \t\r\n/")));
+				StartElement_(name, tag);
+				if (tag.back() == '/')
+				{
+					EndElement_(name, std::string_view());
+				}
+			}
+
+			// Keeps the characters following the last tag, as these may be the start of the text of the next element.
+			buffer.erase(0, consumed);
+			if (m_file_reader$.input_stream.eof())
+			{
+				buffer.clear();
 			}
 		}
 		catch (std::runtime_error& error)
@@ -46,516 +116,401 @@ namespace TAPP::Filetypes::Mzid
 
 	void Mzid_Parser::Setup$(const std::string& filepath)
 	{
-		m_current_stage_ = SEQUENCES;
+		Closure$();
+		m_scopes_.clear();
+		m_record_valid_ = true;
 		m_return_object$ = Mzid_File();
 		m_return_object$.filename = FilepathToFilename(filepath);
 	}
 
 	/*** Private Functions ******************************************************/
 
-	bool Mzid_Parser::ParseEvidences_(std::string& buffer)
+	void Mzid_Parser::StartElement_(const std::string_view name, const std::string_view tag)
 	{
-		// Prepares the vector that will hold the new evidence objects.
-		std::vector<PeptideEvidence> evidences; // Yes, the plural form used here is incorrect.
-		evidences.reserve(CountSubstrings(buffer, "<PeptideEvidence "));
-
-		// Acquires the initial evidence.
-		size_t evidence_previous = 0;
-		size_t evidence_start = buffer.find("<PeptideEvidence ");
-		size_t evidence_end = buffer.find('\n', evidence_start);
-
-		while (evidence_start != std::string::npos && evidence_end != std::string::npos)
-		{
-			evidences.push_back({
-				(unsigned short)stoi(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("end", evidence_start))),
-				(unsigned short)stoi(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("start", evidence_start))),
-				GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("id=", evidence_start)),
-				"true" == GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("isDecoy", evidence_start)),
-				GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("post", evidence_start))[0],
-				GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("pre", evidence_start))[0],
-				&m_return_object$.peptides.find(m_hasher_(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("peptide_ref", evidence_start))))->second,
-				&m_return_object$.sequences.find(m_hasher_(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("dBSequence_ref", evidence_start))))->second
-			});
+		Scope scope = m_scopes_.empty() ? NONE : m_scopes_.back();
+		Collections::StringPool& strings = m_return_object$.strings;
 
-			evidence_previous = evidence_end;
-			evidence_start = buffer.find("<PeptideEvidence ", evidence_end);
-			evidence_end = buffer.find('\n', evidence_start);
+		if (name == "cvParam" || name == "userParam")
+		{
+			ParseCV_Parameter_(tag);
 		}
-
-		// Merges the vector with the existing vector.
-		m_return_object$.peptide_evidence.reserve(m_return_object$.peptide_evidence.size() + evidences.size());
-		for (PeptideEvidence evidence : evidences)
+		else if (name == "DBSequence")
 		{
-			m_return_object$.peptide_evidence.insert({ m_hasher_(evidence.id), evidence });
+			m_scopes_.push_back(SEQUENCE);
+			m_sequence_ = { strings.Intern(GetAttributeView(tag, "accession")), std::string_view(), strings.Store(GetAttributeView(tag, "id")) };
 		}
-
-		// Trims the buffer so it only includes unparsed characters.
-		buffer = buffer.substr(buffer.find('\n', evidence_previous));
-
-		return buffer.find("</SequenceCollection") != std::string::npos;
-	}
-
-	bool Mzid_Parser::ParseProteinGroup_(std::string& buffer)
-	{
-		// Prepares the vector that will hold the new ProteinGroup objects.
-		std::vector<ProteinGroup> protein_groups;
-		protein_groups.reserve(CountSubstrings(buffer, "<ProteinA"));
-
-		// Acquires the initial protein grouping.
-		size_t protein_previous = 0;
-		size_t protein_start = buffer.find("<ProteinA");
-		size_t protein_end = buffer.find("</ProteinA", protein_start);
-
-		// Only parses a protein group if all of its information is present within the buffer.
-		while (protein_start != std::string::npos && protein_end != std::string::npos)
+		else if (name == "Peptide")
 		{
-			std::vector<ProteinHypothesis> hypotheses(ParsePeptideHypothesis_(buffer, protein_start, protein_end));
-			size_t hypothesis_end = buffer.find("</ProteinD", buffer.find(hypotheses.back().id, protein_start));
-
-			// Adds the protein group information to the vector.
-			protein_groups.push_back(
-			{
-				GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("id", protein_start)),
-				ParseCV_Parameters_(buffer, hypothesis_end, protein_end),
-				std::move(hypotheses)
-			});
-
-			// Searches for the next protein group.
-			protein_previous = protein_end;
-			protein_start = buffer.find("<ProteinA", protein_end);
-			protein_end = buffer.find("</ProteinA", protein_start);
+			m_scopes_.push_back(PEPTIDE);
+			m_peptide_ = { strings.Store(GetAttributeView(tag, "id")), std::string_view(), std::vector<Modification>() };
 		}
-
-		// Merges the vector with the existing vector.
-		m_return_object$.peptides.reserve(m_return_object$.peptides.size() + protein_groups.size());
-		for (ProteinGroup group : protein_groups)
+		else if (name == "Modification" && scope == PEPTIDE)
 		{
-			m_return_object$.protein_groups.insert({ m_hasher_(group.id), group });
+			m_scopes_.push_back(MODIFICATION);
+			ParseModification_(tag);
 		}
-
-		// Trims the buffer so it only includes unparsed characters.
-		buffer = buffer.substr(buffer.find('>', protein_previous));
-
-		return buffer.find("</ProteinDetectionList>") != std::string::npos;
-	}
-
-	std::vector<ProteinHypothesis> Mzid_Parser::ParsePeptideHypothesis_(std::string& buffer, size_t start_position, size_t end_position)
-	{
-		// Creates the initial hypothesis vector.
-		std::vector<ProteinHypothesis> hypothesis;
-
-		size_t hypothesis_start = buffer.find("<ProteinD", start_position);
-		size_t hypothesis_end = buffer.find("</ProteinD", hypothesis_start);
-		while (hypothesis_start < end_position && hypothesis_start != std::string::npos)
+		else if (name == "PeptideEvidence")
 		{
-			// Creates a new hypothesis object.
-			hypothesis.push_back(ProteinHypothesis());
-
-			// Adds the spectrum references.
-			size_t spectrum_position = buffer.find("spectrumIdentificationItem_ref", hypothesis_start);
-			while (spectrum_position != std::string::npos && spectrum_position < hypothesis_end)
+			ParseEvidence_(tag);
+		}
+		else if (name == "SpectrumIdentificationResult")
+		{
+			m_scopes_.push_back(RESULT);
+			ParseIdentificationResult_(tag);
+		}
+		else if (name == "SpectrumIdentificationItem" && scope == RESULT)
+		{
+			m_scopes_.push_back(ITEM);
+			ParseIdentificationItem_(tag);
+		}
+		else if (name == "PeptideEvidenceRef" && scope == ITEM)
+		{
+			PeptideEvidence* evidence = Resolve_(m_evidence_ids_, GetAttributeView(tag, "peptideEvidence_ref"), "peptide evidence");
+			if (evidence)
 			{
-				// If the item entry cannot be located, throw an error.
-				auto identification_item_entry = m_return_object$.identification_items.find(m_hasher_(GetEmbeddedCharacters(buffer, m_brackets_, spectrum_position)));
-				if (!m_ignore_file_errors_ && identification_item_entry == m_return_object$.identification_items.end())
-				{
-					throw std::runtime_error("Couldn't locate identification item with id: " + GetEmbeddedCharacters(buffer, m_brackets_, spectrum_position));
-				}
-				else if (identification_item_entry != m_return_object$.identification_items.end())
-				{
-					hypothesis.back().items.push_back(&identification_item_entry->second);
-				}
-				spectrum_position = buffer.find("spectrumIdentificationItem_ref", spectrum_position + 22);
+				m_items_.back().peptide_evidences.push_back(evidence);
 			}
-			
-			// Fills the remaining fields.
-			hypothesis.back().evidence			= &m_return_object$.peptide_evidence.find(m_hasher_(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("peptideEvidence_ref", hypothesis_start))))->second;
-			hypothesis.back().id				= GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("id", hypothesis_start));
-			hypothesis.back().passed_threshold	= "true" == GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("passThreshold", hypothesis_start));
-			hypothesis.back().sequence			= &m_return_object$.sequences.find(m_hasher_(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("dBSequence_ref", hypothesis_start))))->second;
-		
-			hypothesis_start	= buffer.find("<ProteinD", hypothesis_end);
-			hypothesis_end		= buffer.find("</ProteinD", hypothesis_start);
-		}
-
-		return hypothesis;
-	}
-
-	bool Mzid_Parser::ParsePeptides_(std::string& buffer)
-	{
-		// Prepares the vector that will hold the new peptide objects.
-		std::vector<Peptide> peptides;
-		peptides.reserve(CountSubstrings(buffer, "<Peptide"));
-
-		// Acquires the initial peptide.
-		size_t peptide_previous = 0;
-		size_t peptide_start = buffer.find("<Peptide");
-		size_t peptide_end = buffer.find("</Peptide>", peptide_start);
-
-		// Only parses a peptide if all of its information is present within the buffer.
-		while (peptide_start != std::string::npos && peptide_end != std::string::npos)
-		{
-			size_t id_position = buffer.find("id=", peptide_start);
-			size_t sequence_position = buffer.find("PeptideSequence", id_position);
-
-			// Collects the modifications.
-			std::vector<Modification> modifications;
-			size_t modification_position = buffer.find("<Modification", sequence_position);
-			while (modification_position < peptide_end && modification_position != std::string::npos)
+			else
 			{
-				// Acquires the various information present regarding the modifications.
-				std::string reference(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("cvRef", modification_position)));
-				std::string name(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("name", modification_position)));
-
-				modifications.push_back({
-					(unsigned short)stoi(GetEmbeddedCharacters(buffer, ':', '"', buffer.find("accession", modification_position))),
-					(unsigned short)stoi(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("location", modification_position))),
-					(double)stod(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("monoisotopicMassDelta", modification_position))),
-					&m_return_object$.cv_references.insert({ m_hasher_(reference), reference }).first->second,
-					&m_return_object$.modification_names.insert({ m_hasher_(name), name }).first->second,
-					(char)GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("residues", modification_position))[0]
-				});
-
-				modification_position = buffer.find("<Modification", modification_position + 1);
+				m_record_valid_ = false;
 			}
-
-			// Creates and pushes the peptide struct.
-			peptides.push_back({
-				GetEmbeddedCharacters(buffer, m_brackets_, id_position),
-				GetEmbeddedCharacters(buffer, '>','<', sequence_position),
-				std::move(modifications)
+		}
+		else if (name == "IonType" && scope == ITEM)
+		{
+			m_scopes_.push_back(IONTYPE);
+			m_items_.back().fragmentations.push_back({
+				std::string(GetAttributeView(tag, "index")),
+				std::string_view(),
+				ParseNumber<unsigned char>(GetAttributeView(tag, "charge")),
+				std::vector<double>(),
+				std::vector<double>(),
+				std::vector<double>()
 			});
-
-			// Searches for the next peptide.
-			peptide_previous = peptide_end;
-			peptide_start = buffer.find("<Peptide", peptide_end);
-			peptide_end = buffer.find("</Peptide>", peptide_start);
 		}
-
-		// Merges the vector with the existing map.
-		m_return_object$.peptides.reserve(m_return_object$.peptides.size() + peptides.size());
-		for (Peptide peptide : peptides)
+		else if (name == "FragmentArray" && scope == IONTYPE)
 		{
-			m_return_object$.peptides.insert({ m_hasher_(peptide.id), peptide });
+			ParseFragmentArray_(tag);
 		}
-
-		// Trims the buffer so it only includes unparsed characters.
-		buffer = buffer.substr(buffer.find('>', peptide_previous));
-
-		return buffer.find("<PeptideEvidence") != std::string::npos;
-	}
-
-	bool Mzid_Parser::ParseSequences_(std::string& buffer)
-	{
-		// Prepares the vector that will hold the new sequence objects.
-		std::vector<Sequence> sequences;
-		sequences.reserve(CountSubstrings(buffer, "<DBS"));
-
-		// Acquires the initial sequence.
-		size_t sequence_previous = 0;
-		size_t sequence_start = buffer.find("<DBS");
-		size_t sequence_end = buffer.find("</DBS", sequence_start);
-
-		// Checks if the value information needs to be parsed as well.
-		bool value_present = true;
-		size_t description_position = buffer.find("ue=", sequence_start, sequence_end - sequence_start);
-		if (description_position == std::string::npos)
+		else if (name == "ProteinAmbiguityGroup")
 		{
-			value_present = false;
+			m_scopes_.push_back(GROUP);
+			m_group_ = { strings.Store(GetAttributeView(tag, "id")), std::vector<CV_Parameter>(), std::vector<ProteinHypothesis>() };
 		}
-
-		// Only parses a sequence if all of its information is present within the buffer.
-		while (sequence_start != std::string::npos && sequence_end != std::string::npos)
+		else if (name == "ProteinDetectionHypothesis" && scope == GROUP)
 		{
-			// Acquires the positions of the id information.
-			size_t id_position = buffer.find("id", sequence_start);
-
-			// Tries to acquire the description.
-			std::string description;
-			if (value_present)
+			m_scopes_.push_back(HYPOTHESIS);
+
+			Sequence* sequence = Resolve_(m_sequence_ids_, GetAttributeView(tag, "dBSequence_ref"), "sequence");
+			m_record_valid_ = sequence != nullptr;
+			m_group_.hypotheses.push_back({
+				strings.Store(GetAttributeView(tag, "id")),
+				GetAttributeView(tag, "passThreshold") == "true",
+				nullptr,
+				sequence,
+				std::vector<SpectrumIdentificationItem*>()
+			});
+		}
+		else if (name == "PeptideHypothesis" && scope == HYPOTHESIS && !m_group_.hypotheses.back().evidence)
+		{
+			m_group_.hypotheses.back().evidence = Resolve_(m_evidence_ids_, GetAttributeView(tag, "peptideEvidence_ref"), "peptide evidence");
+		}
+		else if (name == "SpectrumIdentificationItemRef" && scope == HYPOTHESIS)
+		{
+			// Hypotheses only lose the items that can't be located.
+			SpectrumIdentificationItem* item = Resolve_(m_item_ids_, GetAttributeView(tag, "spectrumIdentificationItem_ref"), "identification item");
+			if (item)
 			{
-				description = GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("ue=", sequence_start, sequence_end - sequence_start));
+				m_group_.hypotheses.back().items.push_back(item);
 			}
+		}
+	}
 
-			// Acquires the information and places it into a struct, which is passed into the vector.
-			sequences.push_back({
-				std::move(description),
-				GetEmbeddedCharacters(buffer, m_brackets_, id_position) });
+	void Mzid_Parser::EndElement_(const std::string_view name, const std::string_view text)
+	{
+		Scope scope = m_scopes_.empty() ? NONE : m_scopes_.back();
+		Mzid_File& file = m_return_object$;
 
-			// Searches for the next sequence.
-			sequence_previous	= sequence_end;
-			sequence_start		= buffer.find("<DBS", sequence_end);
-			sequence_end		= buffer.find("</DBS", sequence_start);
+		if (name == "PeptideSequence" && scope == PEPTIDE)
+		{
+			m_peptide_.sequence = file.strings.Intern(text);
 		}
-
-		// Merges the vector with the existing vector.
-		m_return_object$.sequences.reserve(m_return_object$.sequences.size() + sequences.size());
-		for (Sequence sequence : sequences)
+		else if (name == "DBSequence" && scope == SEQUENCE)
 		{
-			m_return_object$.sequences.insert({ m_hasher_(sequence.id), sequence });
+			m_scopes_.pop_back();
+			file.sequences.push_back(m_sequence_);
+			m_sequence_ids_.insert({ file.sequences.back().id, &file.sequences.back() });
 		}
-
-		// Trims the buffer so it only includes unparsed characters.
-		size_t end_marker = buffer.find('>', sequence_previous);
-		if (end_marker != std::string::npos)
+		else if (name == "Peptide" && scope == PEPTIDE)
 		{
-			buffer = buffer.substr(end_marker);
+			m_scopes_.pop_back();
+			file.peptides.push_back(std::move(m_peptide_));
+			m_peptide_ids_.insert({ file.peptides.back().id, &file.peptides.back() });
 		}
-		else
+		else if ((name == "Modification" && scope == MODIFICATION) || (name == "SpectrumIdentificationItem" && scope == ITEM) || (name == "IonType" && scope == IONTYPE))
 		{
-			buffer = buffer.substr(sequence_previous);
+			m_scopes_.pop_back();
+		}
+		else if (name == "SpectrumIdentificationResult" && scope == RESULT)
+		{
+			m_scopes_.pop_back();
+			CloseIdentificationResult_();
+		}
+		else if (name == "ProteinDetectionHypothesis" && scope == HYPOTHESIS)
+		{
+			m_scopes_.pop_back();
+			if (m_record_valid_ && !m_group_.hypotheses.back().evidence)
+			{
+				ReportError_("Protein hypothesis " + std::string(m_group_.hypotheses.back().id) + " doesn't reference any peptide evidence.");
+				m_record_valid_ = false;
+			}
+			if (!m_record_valid_)
+			{
+				m_group_.hypotheses.pop_back();
+			}
+		}
+		else if (name == "ProteinAmbiguityGroup" && scope == GROUP)
+		{
+			m_scopes_.pop_back();
+			file.protein_groups.push_back(std::move(m_group_));
 		}
-
-		// Returns true if this part of the buffer contained the sequence collection end tag.
-		return buffer.find("<Peptide") != std::string::npos;
 	}
 
-	bool Mzid_Parser::ParseSpectrumIdentificationResults_(std::string& buffer)
+	void Mzid_Parser::ParseCV_Parameter_(const std::string_view tag)
 	{
-		size_t result_previous = 0;
-		size_t result_start = buffer.find("<SpectrumIdentificationResult");
-		size_t result_end = buffer.find("</SpectrumIdentificationResult", result_start);
+		std::string_view name(GetAttributeView(tag, "name"));
+		std::string_view value(GetAttributeView(tag, "value"));
 
-		while (result_start != std::string::npos && result_end != std::string::npos)
+		switch (m_scopes_.empty() ? NONE : m_scopes_.back())
 		{
-			// Acquires the positions for the required values.
-			size_t file_position		= buffer.find("spectraData_ref", result_start) + 15;
-			size_t index_position		= buffer.find("spectrumID", result_start) + 14;
-			size_t id_position			= buffer.find("id", result_start) + 2;
-			size_t scan_position		= buffer.find("scan", result_start);
-			size_t retention_position	= buffer.find("retention time", result_start);
-
-			// Calculates the scan and retention time values.
-			size_t scan = (size_t)-1;
-			double retention_time = 0;
+			case SEQUENCE:
+				if (m_sequence_.description.empty())
+				{
+					m_sequence_.description = m_return_object$.strings.Store(value);
+				}
+				break;
 
-			if (scan_position != std::string::npos)
+			case MODIFICATION:
 			{
-				scan = std::stoi(GetEmbeddedCharacters(buffer, '=', '&', scan_position));
+				// The first parameter describes the modification, of which the accession is numbered after the ontology name.
+				Modification& modification = m_peptide_.modifications.back();
+				if (modification.name.empty())
+				{
+					std::string_view accession(GetAttributeView(tag, "accession"));
+					modification.accession		= ParseNumber<unsigned short>(accession.substr(accession.find(':') + 1));
+					modification.cv_reference	= m_return_object$.strings.Intern(GetAttributeView(tag, "cvRef"));
+					modification.name			= m_return_object$.strings.Intern(name);
+				}
+				break;
 			}
 
-			if (retention_position != std::string::npos)
+			case RESULT:
 			{
-				retention_time = std::atof(GetEmbeddedCharacters(buffer, m_brackets_, retention_position + 15).c_str());
+				size_t scan_position = value.find("scan=");
+				if (name == "retention time" || name == "scan start time")
+				{
+					m_result_.retention_time = ParseNumber<double>(value);
+				}
+				else if (m_result_.scan_id == (size_t)-1 && name == "scan number(s)")
+				{
+					m_result_.scan_id = ParseNumber<size_t>(value, (size_t)-1);
+				}
+				else if (m_result_.scan_id == (size_t)-1 && scan_position != std::string_view::npos)
+				{
+					// Spectrum titles carry the scan within their native identifier.
+					m_result_.scan_id = ParseNumber<size_t>(value.substr(scan_position + 5), (size_t)-1);
+				}
+				break;
 			}
 
-			// Acquires the iterator to a file entry, or creates a new one.
-			auto file_iterator = m_return_object$.file_sorted_identifications.insert(
+			case ITEM:
+			case GROUP:
 			{
-				GetEmbeddedCharacters(buffer, m_brackets_, file_position),
-				std::vector<SpectrumIdentificationResult*>()
-			}).first;
-
-			// Adds a new result to the identifications map.
-			std::string id(GetEmbeddedCharacters(buffer, m_brackets_, id_position));
+				if (value.empty())
+				{
+					break;
+				}
 
-			// If any errors occur during processing of the identification result, either ignore the result or throw a runtime error.
-			try
-			{
-				auto result_iterator = m_return_object$.identification_results.insert(
-				{ 
-					m_hasher_(id),
-					{
-						id,
-						size_t(stoi(GetEmbeddedCharacters(buffer, '=', '"', index_position))),
-						retention_time,
-						scan,
-						ParseSpectrumIdentificationItem_(buffer, result_start, result_end)
-					}
-				}).first;
+				// Keeps a single copy of each name, which the parameters refer to.
+				auto name_entry = m_cv_param_names_.find(name);
+				if (name_entry == m_cv_param_names_.end())
+				{
+					const std::string& stored_name = *m_return_object$.cv_param_names.insert(std::string(name)).first;
+					name_entry = m_cv_param_names_.insert({ stored_name, &stored_name }).first;
+				}
 
-				// Adds the identification to the file vector.
-				file_iterator->second.push_back(&result_iterator->second);
+				std::vector<CV_Parameter>& parameters = m_scopes_.back() == ITEM ? m_items_.back().cv_parameters : m_group_.cv_parameters;
+				parameters.push_back({ *name_entry->second, value == "true" ? 1.0 : ParseNumber<double>(value) });
+				break;
 			}
-			catch (std::runtime_error& error)
-			{
-				if (!m_ignore_file_errors_)
+
+			case IONTYPE:
+				if (m_items_.back().fragmentations.back().name.empty())
 				{
-					throw std::runtime_error("Error during the parsing of result: " + id + "\n" + std::string(error.what()));
+					m_items_.back().fragmentations.back().name = m_return_object$.strings.Intern(name);
 				}
-			}
+				break;
 
-			result_previous = result_end;
-			result_start = buffer.find("<SpectrumIdentificationResult", result_end);
-			result_end = buffer.find("</SpectrumIdentificationResult>", result_start);
+			default:
+				break;
 		}
-
-		// Trims the buffer so it only includes unparsed characters.
-		buffer = buffer.substr(buffer.find('>', result_previous));
-
-		return buffer.find("</SpectrumIdentificationList>") != std::string::npos;
 	}
 
-	// Extracts the item information from the passed string.
-	std::vector<SpectrumIdentificationItem*> Mzid_Parser::ParseSpectrumIdentificationItem_(std::string& buffer, size_t start_position, size_t end_position)
+	void Mzid_Parser::ParseEvidence_(const std::string_view tag)
 	{
-		// Parses the Identification Items within the range of the current Identification Result.
-		std::vector<SpectrumIdentificationItem> parsed_items;
-		size_t item_begin = buffer.find("<SpectrumIdentificationItem", start_position);
-		size_t item_end = buffer.find("</SpectrumIdentificationItem", item_begin);
-		while (item_begin != std::string::npos && item_end < end_position)
-		{
-			// Acquires all the positions for the required variables.
-			size_t passed_position = buffer.find("passThreshold", item_begin);
-			size_t rank_position = buffer.find("rank", item_begin);
-			size_t peptide_reference_position = buffer.find("peptide_ref", item_begin);
-			size_t calculated_mz_position = buffer.find("calculatedMassToCharge", item_begin);
-			size_t experimental_mz_position = buffer.find("experimentalMassToCharge", item_begin);
-			size_t chargestate_position = buffer.find("chargeState", item_begin);
-			size_t id_position = buffer.find("id=", item_begin);
-
-			// Attempts to find the peptide, throws an error if it is unable to.
-			auto peptide_entry = m_return_object$.peptides.find(m_hasher_(GetEmbeddedCharacters(buffer, m_brackets_, peptide_reference_position)));
-			if (!m_ignore_file_errors_ && peptide_entry == m_return_object$.peptides.end())
-			{
-				throw std::runtime_error("Couldn't locate peptide with the id: " + GetEmbeddedCharacters(buffer, m_brackets_, peptide_reference_position));
-			}
+		std::string_view id(GetAttributeView(tag, "id"));
+		std::string_view post(GetAttributeView(tag, "post"));
+		std::string_view pre(GetAttributeView(tag, "pre"));
 
-			// Extracts the data from the string, pushes the new Identification Item into the vector..
-			parsed_items.push_back(
-			{
-				GetEmbeddedCharacters(buffer, m_brackets_, id_position),
-				(unsigned char)std::stoi(GetEmbeddedCharacters(buffer, m_brackets_, chargestate_position)),
-				std::atof(GetEmbeddedCharacters(buffer, m_brackets_, calculated_mz_position).c_str()),
-				std::atof(GetEmbeddedCharacters(buffer, m_brackets_, experimental_mz_position).c_str()),
-				"true" == GetEmbeddedCharacters(buffer, m_brackets_, passed_position),
-				(unsigned short)std::stoi(GetEmbeddedCharacters(buffer, m_brackets_, rank_position)),
-				&peptide_entry->second,
-				ParseCV_Parameters_(buffer, item_begin, item_end),
-				ParseSpectrumEvidences_(buffer, item_begin, item_end),
-				ParseSpectrumIons_(buffer, item_begin, item_end)
-			});
+		Peptide* peptide	= Resolve_(m_peptide_ids_, GetAttributeView(tag, "peptide_ref"), "peptide");
+		Sequence* sequence	= Resolve_(m_sequence_ids_, GetAttributeView(tag, "dBSequence_ref"), "sequence");
+		if (!peptide || !sequence)
+		{
+			return;
+		}
 
-			int a = 10;
-			unsigned int b = (unsigned int)a;
-			unsigned int c(a);
+		m_return_object$.peptide_evidence.push_back({
+			ParseNumber<unsigned short>(GetAttributeView(tag, "end")),
+			ParseNumber<unsigned short>(GetAttributeView(tag, "start")),
+			m_return_object$.strings.Store(id),
+			GetAttributeView(tag, "isDecoy") == "true",
+			post.empty() ? '\0' : post[0],
+			pre.empty() ? '\0' : pre[0],
+			peptide,
+			sequence
+		});
+		m_evidence_ids_.insert({ m_return_object$.peptide_evidence.back().id, &m_return_object$.peptide_evidence.back() });
+	}
 
+	void Mzid_Parser::ParseFragmentArray_(const std::string_view tag)
+	{
+		Iontype& iontype = m_items_.back().fragmentations.back();
+		std::string_view measure(GetAttributeView(tag, "measure_ref"));
 
-			// Attempts to find additional identification items.
-			item_begin = buffer.find("<SpectrumIdentificationItem", item_end);
-			item_end = buffer.find("</SpectrumIdentificationItem", item_begin);
+		std::vector<double>* values = nullptr;
+		if (measure == "Measure_MZ")
+		{
+			values = &iontype.mz_values;
 		}
-
-		// Inserts the Identification Items into the Mzid_File object and creates the pointer return vector.
-		std::vector<SpectrumIdentificationItem*> inserted_items;
-		inserted_items.reserve(parsed_items.size());
-		for (SpectrumIdentificationItem& item : parsed_items)
+		else if (measure == "Measure_Int")
+		{
+			values = &iontype.intensity_values;
+		}
+		else if (measure == "Measure_Error")
 		{
-			inserted_items.push_back(&m_return_object$.identification_items.insert({ m_hasher_(item.id), item }).first->second);
+			values = &iontype.error_values;
+		}
+		else
+		{
+			return;
 		}
 
-		return inserted_items;
+		std::string_view list(GetAttributeView(tag, "values"));
+		values->reserve(std::count(list.begin(), list.end(), ' ') + 1);
+		for (size_t start = list.find_first_not_of(' '); start != std::string_view::npos; start = list.find_first_not_of(' ', start))
+		{
+			size_t end = std::min(list.find(' ', start), list.size());
+			values->push_back(ParseNumber<double>(list.substr(start, end - start)));
+			start = end;
+		}
 	}
 
-	std::vector<CV_Parameter> Mzid_Parser::ParseCV_Parameters_(std::string& buffer, size_t start_position, size_t end_position)
+	void Mzid_Parser::ParseIdentificationItem_(const std::string_view tag)
 	{
-		std::vector<CV_Parameter> parameters;
-		size_t parameter_position = buffer.find("cvParam", start_position);
-		parameter_position = buffer.find("name", parameter_position);
-		while (parameter_position != std::string::npos && parameter_position < end_position)
+		Peptide* peptide = Resolve_(m_peptide_ids_, GetAttributeView(tag, "peptide_ref"), "peptide");
+		if (!peptide)
 		{
-			try
-			{
-				std::string value(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("value=", parameter_position)));
-				double converted_value = 0;
-				if (value == "true")
-				{
-					// Variable value is compared to "true" and results in a boolean.
-					converted_value = value == "true";
-				}
-				else
-				{
-					converted_value = std::atof(value.c_str());
-				}
-
-				parameters.push_back(
-				{
-					*m_return_object$.cv_param_names.insert(GetEmbeddedCharacters(buffer, m_brackets_, parameter_position)).first,
-					converted_value
-				});
-			}
-			catch (...)
-			{
-				// Ignore value if an exception is thrown.
-			}
-
-			parameter_position = buffer.find("name", parameter_position+1);
+			m_record_valid_ = false;
 		}
 
-		return parameters;
+		m_items_.push_back({
+			m_return_object$.strings.Store(GetAttributeView(tag, "id")),
+			ParseNumber<unsigned char>(GetAttributeView(tag, "chargeState")),
+			ParseNumber<double>(GetAttributeView(tag, "calculatedMassToCharge")),
+			ParseNumber<double>(GetAttributeView(tag, "experimentalMassToCharge")),
+			GetAttributeView(tag, "passThreshold") == "true",
+			ParseNumber<unsigned short>(GetAttributeView(tag, "rank")),
+			peptide,
+			std::vector<CV_Parameter>(),
+			std::vector<PeptideEvidence*>(),
+			std::vector<Iontype>()
+		});
 	}
 
-	std::vector<PeptideEvidence*> Mzid_Parser::ParseSpectrumEvidences_(std::string& buffer, size_t start_position, size_t end_position)
+	void Mzid_Parser::ParseIdentificationResult_(const std::string_view tag)
 	{
-		std::vector<PeptideEvidence*> evidences;
-
-		size_t evidences_position = buffer.find("peptideEvidence_ref", start_position) + 20;
-		while (evidences_position != std::string::npos && evidences_position < end_position)
+		// The index follows the last equals sign of the spectrum identifier, as in "index=5". Native identifiers also carry
+		// the scan, as in "controllerType=0 controllerNumber=1 scan=5", which takes precedence over the parameters of the result.
+		std::string_view spectrum(GetAttributeView(tag, "spectrumID"));
+		size_t index_position = spectrum.find_last_of('=');
+		size_t scan_position = spectrum.find("scan=");
+
+		m_record_valid_ = true;
+		m_items_.clear();
+		m_result_file_	= m_return_object$.strings.Intern(GetAttributeView(tag, "spectraData_ref"));
+		m_result_		=
 		{
-			// If the peptide evidence cannot be located, throw error.
-			auto evidence_entry = m_return_object$.peptide_evidence.find(m_hasher_(GetEmbeddedCharacters(buffer, m_brackets_, evidences_position)));
-			if (evidence_entry == m_return_object$.peptide_evidence.end())
-			{
-				throw std::runtime_error("Couldn't locate peptide evidence with id: " + GetEmbeddedCharacters(buffer, m_brackets_, evidences_position));
-			}
-			else
-			{
-				evidences.push_back(&evidence_entry->second);
-			}
-
-			evidences_position = buffer.find("peptideEvidence_ref", evidences_position + 20);
-		}
-
-		return evidences;
+			m_return_object$.strings.Store(GetAttributeView(tag, "id")),
+			ParseNumber<size_t>(index_position == std::string_view::npos ? spectrum : spectrum.substr(index_position + 1)),
+			0,
+			scan_position == std::string_view::npos ? (size_t)-1 : ParseNumber<size_t>(spectrum.substr(scan_position + 5), (size_t)-1),
+			std::vector<SpectrumIdentificationItem*>()
+		};
 	}
 
-	std::vector<Iontype> Mzid_Parser::ParseSpectrumIons_(std::string& buffer, size_t start_position, size_t end_position)
+	void Mzid_Parser::ParseModification_(const std::string_view tag)
 	{
-		std::vector<Iontype> ions;
+		std::string_view residues(GetAttributeView(tag, "residues"));
+
+		m_peptide_.modifications.push_back({
+			0,
+			ParseNumber<unsigned short>(GetAttributeView(tag, "location")),
+			ParseNumber<double>(GetAttributeView(tag, "monoisotopicMassDelta")),
+			std::string_view(),
+			std::string_view(),
+			residues.empty() ? '\0' : residues[0]
+		});
+	}
 
-		size_t iontype_position = buffer.find("<IonType", start_position);
-		while (iontype_position != std::string::npos && iontype_position < end_position)
+	void Mzid_Parser::CloseIdentificationResult_(void)
+	{
+		// Results with a reference that couldn't be resolved are left out entirely.
+		if (!m_record_valid_)
 		{
-			// Extracts the information.
-			std::vector<std::string> mz_strings = Split(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("Measure_MZ", iontype_position) + 18), ' ');
-			std::vector<std::string> int_strings = Split(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("Measure_Int", iontype_position) + 19), ' ');
-			std::vector<std::string> error_strings = Split(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("Measure_Error", iontype_position) + 21), ' ');
-
-			// Converts the information into boolean vectors.
-			std::vector<double> mz_values;
-			mz_values.reserve(mz_strings.size());
-			for (std::string& value : mz_strings)
-			{
-				mz_values.push_back(std::atof(value.c_str()));
-			}
-
-			std::vector<double> int_values;
-			int_values.reserve(int_strings.size());
-			for (std::string& value : int_strings)
-			{
-				int_values.push_back(std::atof(value.c_str()));
-			}
+			m_items_.clear();
+			return;
+		}
 
-			std::vector<double> error_values;
-			error_values.reserve(error_strings.size());
-			for (std::string& value : error_strings)
-			{
-				error_values.push_back(std::atof(value.c_str()));
-			}
+		Mzid_File& file = m_return_object$;
+		m_result_.items.reserve(m_items_.size());
+		for (SpectrumIdentificationItem& item : m_items_)
+		{
+			file.identification_items.push_back(std::move(item));
+			m_item_ids_.insert({ file.identification_items.back().id, &file.identification_items.back() });
+			m_result_.items.push_back(&file.identification_items.back());
+		}
+		m_items_.clear();
 
-			// Creates an ion object and pushes this into a vector.
-			ions.push_back({
-				GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("index", iontype_position) + 4),
-				GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("name", iontype_position) + 3),
-				(unsigned char)std::stoi(GetEmbeddedCharacters(buffer, m_brackets_, buffer.find("charge", iontype_position) + 5)),
-				mz_values,
-				int_values,
-				error_values
-			});
+		file.identification_results.push_back(std::move(m_result_));
+		file.file_sorted_identifications[m_result_file_].push_back(&file.identification_results.back());
+	}
 
-			iontype_position = buffer.find("<IonType", iontype_position + 1);
+	void Mzid_Parser::ReportError_(const std::string& message)
+	{
+		if (!m_ignore_file_errors_)
+		{
+			throw std::runtime_error(message);
 		}
+	}
 
-		return ions;
+	template <typename T>
+	T* Mzid_Parser::Resolve_(const std::unordered_map<std::string_view, T*>& records, const std::string_view id, const char* type)
+	{
+		auto record = records.find(id);
+		if (record == records.end())
+		{
+			ReportError_("Couldn't locate " + std::string(type) + " with id: " + std::string(id));
+			return nullptr;
+		}
+		return record->second;
 	}
 }
@@ -5,19 +5,22 @@
 
 #pragma once
 
-#include <functional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include "Filetypes/Mzid/Mzid_File.h"
 #include "IO/StreamParser-deprecated.hpp"
-#include "Utilities/StringManipulation.h"
 
 namespace TAPP::Filetypes::Mzid
 {
-	// TODO:	Completely rewrite this class into something that does respect the xml structure.
-
+	/*
+		Reads the file in a single pass, tag by tag. Each start and end tag is passed on to a handler for its element, which
+		fills in the record that is currently open. References are resolved as soon as the record holding them ends,
+		which relies on the order of the mzIdentML schema: sequences, peptides and evidence precede the identifications,
+		which precede the protein groups.
+	*/
 	class Mzid_Parser : public IO::StreamParser<Mzid_File>
 	{
 		public:
@@ -46,29 +49,46 @@ namespace TAPP::Filetypes::Mzid
 		private:
 			/*** Enumerables ************************************************************/
 
-			enum Stage { END, EVIDENCE, IDENTIFICATIONS, PEPTIDES, PROTEIN, SEQUENCES };
+			// The elements that hold records, the innermost one being the owner of cvParams and references met along the way.
+			enum Scope { NONE, SEQUENCE, PEPTIDE, MODIFICATION, RESULT, ITEM, IONTYPE, GROUP, HYPOTHESIS };
 
 			/*** Variables **************************************************************/
 
-			// Constant for the bracket type.
-			const static Utilities::StringManipulation::BracketType	m_brackets_ = Utilities::StringManipulation::QOUTES;
-
-			bool					m_ignore_file_errors_;
-			std::hash<std::string>	m_hasher_;
-			Stage					m_current_stage_;
+			bool																m_ignore_file_errors_;
+			bool																m_record_valid_;
+			std::vector<Scope>													m_scopes_;
+
+			// The records that are currently open.
+			Sequence															m_sequence_;
+			Peptide																m_peptide_;
+			SpectrumIdentificationResult										m_result_;
+			std::string_view													m_result_file_;
+			std::vector<SpectrumIdentificationItem>								m_items_;
+			ProteinGroup														m_group_;
+
+			// Resolves the references by identifier, the keys pointing at the identifiers of the records themselves.
+			std::unordered_map<std::string_view, Sequence*>						m_sequence_ids_;
+			std::unordered_map<std::string_view, Peptide*>						m_peptide_ids_;
+			std::unordered_map<std::string_view, PeptideEvidence*>				m_evidence_ids_;
+			std::unordered_map<std::string_view, SpectrumIdentificationItem*>	m_item_ids_;
+			std::unordered_map<std::string_view, const std::string*>			m_cv_param_names_;
 
 			/*** Functions **************************************************************/
 
-			bool 										ParseEvidences_(std::string& buffer);
-			bool 										ParsePeptides_(std::string& buffer);
-			bool 										ParseProteinGroup_(std::string& buffer);
-			bool 										ParseSequences_(std::string& buffer);
-			bool										ParseSpectrumIdentificationResults_(std::string& buffer);
-
-			std::vector<ProteinHypothesis>				ParsePeptideHypothesis_(std::string& buffer, size_t start_position, size_t end_position);
-			std::vector<SpectrumIdentificationItem*>	ParseSpectrumIdentificationItem_(std::string& buffer, size_t start_position, size_t end_position);
-			std::vector<CV_Parameter>					ParseCV_Parameters_(std::string& buffer, size_t start_position, size_t end_position);
-			std::vector<PeptideEvidence*>				ParseSpectrumEvidences_(std::string& buffer, size_t start_position, size_t end_position);
-			std::vector<Iontype>						ParseSpectrumIons_(std::string& buffer, size_t start_position, size_t end_position);
+			void StartElement_(const std::string_view name, const std::string_view tag);
+			void EndElement_(const std::string_view name, const std::string_view text);
+
+			void ParseCV_Parameter_(const std::string_view tag);
+			void ParseEvidence_(const std::string_view tag);
+			void ParseFragmentArray_(const std::string_view tag);
+			void ParseIdentificationItem_(const std::string_view tag);
+			void ParseIdentificationResult_(const std::string_view tag);
+			void ParseModification_(const std::string_view tag);
+
+			void CloseIdentificationResult_(void);
+			void ReportError_(const std::string& message);
+
+			template <typename T>
+			T* Resolve_(const std::unordered_map<std::string_view, T*>& records, const std::string_view id, const char* type);
 	};
-}
+}
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <functional>
 
+#include "Filetypes/TAPP/TAPP_Output.h"
 #include "Utilities/StringManipulation.h"
 
 namespace TAPP::Filetypes::TAPP
@@ -79,7 +80,7 @@ namespace TAPP::Filetypes::TAPP
 		return IPL_files;
 	}
 
-	void WriteIPL(std::ostream& out, const std::vector<IPL>& records, const Filetypes::DSV::Grammar grammar, const bool output_header)
+	void WriteIPL(std::ostream& out, const std::vector<IPL>& records, const Filetypes::DSV::Grammar grammar, const bool output_header, const size_t thread_count)
 	{
 		if (output_header)
 		{
@@ -93,27 +94,30 @@ namespace TAPP::Filetypes::TAPP
 			out << grammar.record_delimiter;
 		}
 
-		for (const IPL& record : records)
+		WriteRecords(out, records, [grammar](TextFormatter& text, const IPL& record)
 		{
-			out								<< record.cluster_id											<< grammar.value_delimiter
-											<< record.cluster_group											<< grammar.value_delimiter
-											<< record.event_peak											<< grammar.value_delimiter
-											<< record.event_id												<< grammar.value_delimiter
-			<< grammar.value_encapsulation	<< record.identification_id		<< grammar.value_encapsulation	<< grammar.value_delimiter
-											<< record.identification_method									<< grammar.value_delimiter
-											<< std::to_string(record.chargestate)							<< grammar.value_delimiter;
-
-			out << grammar.value_encapsulation;
+			text.AppendInteger(record.cluster_id);			text.AppendChar(grammar.value_delimiter);
+			text.AppendInteger(record.cluster_group);		text.AppendChar(grammar.value_delimiter);
+			text.AppendInteger(record.event_peak);			text.AppendChar(grammar.value_delimiter);
+			text.AppendInteger(record.event_id);			text.AppendChar(grammar.value_delimiter);
+			text.AppendChar(grammar.value_encapsulation);
+			text.AppendString(record.identification_id);
+			text.AppendChar(grammar.value_encapsulation);	text.AppendChar(grammar.value_delimiter);
+			text.AppendChar(record.identification_method);	text.AppendChar(grammar.value_delimiter);
+			text.AppendInteger(record.chargestate);			text.AppendChar(grammar.value_delimiter);
+
+			text.AppendChar(grammar.value_encapsulation);
 			for (size_t peak : record.cluster_peaks)
 			{
-				out << peak;
+				text.AppendInteger(peak);
 
 				if (peak != record.cluster_peaks.back())
 				{
-					out << ',';
+					text.AppendChar(',');
 				}
 			}
-			out << grammar.value_encapsulation << grammar.record_delimiter;
-		}
+			text.AppendChar(grammar.value_encapsulation);
+			text.AppendChar(grammar.record_delimiter);
+		}, thread_count);
 	}
 }
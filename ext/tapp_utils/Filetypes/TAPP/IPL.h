@@ -49,5 +49,6 @@ namespace TAPP::Filetypes::TAPP
 	/// <param name="records">The records to write into the outstream.</param>
 	/// <param name="grammar">The data separated value grammar for the IPL file.</param>
 	/// <param name="output_header">Whether or not to write the header into the outstream.</param>
-	void WriteIPL(std::ostream& out, const std::vector<IPL>& records, const Filetypes::DSV::Grammar grammar, const bool output_header);
+	/// <param name="thread_count">The amount of threads formatting the records, 0 for one per core. The records are written in order either way.</param>
+	void WriteIPL(std::ostream& out, const std::vector<IPL>& records, const Filetypes::DSV::Grammar grammar, const bool output_header, const size_t thread_count = 0);
 }
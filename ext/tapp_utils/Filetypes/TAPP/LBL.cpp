@@ -0,0 +1,183 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#include "Filetypes/TAPP/LBL.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Exceptions/FileAccessError.h"
+#include "Exceptions/FormatError.h"
+#include "Mesh/FSUtil.h"
+
+namespace TAPP::Filetypes::TAPP
+{
+	// Identifies the file and its layout. The table and runs are stored in platform endianness.
+	const static char		LBL_MAGIC[4]	= { 'T', 'L', 'B', 'L' };
+	const static uint32_t	LBL_VERSION		= 1;
+
+	struct LBL_Header
+	{
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	little_endian;
+		uint32_t	run_size;
+		uint32_t	column_count;
+		uint32_t	row_count;
+		uint64_t	peak_count;
+	};
+
+	// The runs are buffered and written in blocks of this many.
+	const static size_t LBL_RUN_BLOCK = 1 << 16;
+
+	LBL_Writer::LBL_Writer(const std::string& filepath, const uint32_t column_count, const uint32_t row_count, const uint64_t peak_count)
+		: m_filepath_(filepath), m_out_(filepath, std::ios::out | std::ios::binary), m_column_count_(column_count), m_row_count_(row_count), m_peak_count_(peak_count)
+	{
+		if (!m_out_.is_open())
+		{
+			throw Exceptions::FileAccessError("Unable to open label map for writing: " + filepath);
+		}
+
+		// The row table is filled in by Close, once the runs are known.
+		LBL_Header header{ { 0 }, LBL_VERSION, FS_LITTLEENDIAN, sizeof(LBL_Run), column_count, row_count, peak_count };
+		memcpy(header.magic, LBL_MAGIC, sizeof(LBL_MAGIC));
+		m_out_.write((const char*)&header, sizeof(header));
+
+		m_row_starts_.assign(1, 0);
+		m_row_starts_.reserve((size_t)row_count + 1);
+		std::vector<uint64_t> table((size_t)row_count + 1, 0);
+		m_out_.write((const char*)table.data(), table.size() * sizeof(uint64_t));
+	}
+
+	void LBL_Writer::WriteRow(const int32_t* labels)
+	{
+		uint64_t run_count = m_row_starts_.back();
+		for (uint32_t column = 0; column < m_column_count_;)
+		{
+			uint32_t end = column + 1;
+			while (end < m_column_count_ && labels[end] == labels[column])
+			{
+				++end;
+			}
+			m_runs_.push_back({ end - column, labels[column] });
+			++run_count;
+			column = end;
+		}
+		m_row_starts_.push_back(run_count);
+
+		if (m_runs_.size() >= LBL_RUN_BLOCK)
+		{
+			m_out_.write((const char*)m_runs_.data(), m_runs_.size() * sizeof(LBL_Run));
+			m_runs_.clear();
+		}
+	}
+
+	void LBL_Writer::Close(void)
+	{
+		if (m_row_starts_.size() != (size_t)m_row_count_ + 1)
+		{
+			throw Exceptions::FormatError("Label map is missing rows: " + m_filepath_);
+		}
+
+		m_out_.write((const char*)m_runs_.data(), m_runs_.size() * sizeof(LBL_Run));
+		m_runs_.clear();
+		m_out_.seekp(sizeof(LBL_Header));
+		m_out_.write((const char*)m_row_starts_.data(), m_row_starts_.size() * sizeof(uint64_t));
+		m_out_.close();
+		if (m_out_.fail())
+		{
+			throw Exceptions::FileAccessError("Unable to write label map: " + m_filepath_);
+		}
+	}
+
+	LBL_Reader::LBL_Reader(const std::string& filepath) : m_filepath_(filepath), m_in_(filepath, std::ios::in | std::ios::binary)
+	{
+		if (!m_in_.is_open())
+		{
+			throw Exceptions::FileAccessError("Unable to open label map: " + filepath);
+		}
+
+		LBL_Header header;
+		m_in_.read((char*)&header, sizeof(header));
+		if (!m_in_ || memcmp(header.magic, LBL_MAGIC, sizeof(LBL_MAGIC)) != 0 || header.version != LBL_VERSION)
+		{
+			throw Exceptions::FormatError("Not a label map: " + filepath);
+		}
+		if (header.little_endian != FS_LITTLEENDIAN || header.run_size != sizeof(LBL_Run))
+		{
+			throw Exceptions::FormatError("Label map was written on an incompatible platform: " + filepath);
+		}
+
+		m_column_count_	= header.column_count;
+		m_row_count_	= header.row_count;
+		m_peak_count_	= header.peak_count;
+		m_row_starts_.resize((size_t)m_row_count_ + 1);
+		m_in_.read((char*)m_row_starts_.data(), m_row_starts_.size() * sizeof(uint64_t));
+		if (!m_in_)
+		{
+			throw Exceptions::FormatError("Label map is truncated: " + filepath);
+		}
+		m_runs_offset_ = sizeof(header) + m_row_starts_.size() * sizeof(uint64_t);
+	}
+
+	std::vector<int32_t> LBL_Reader::ReadRegion(uint32_t column_begin, uint32_t row_begin, uint32_t column_end, uint32_t row_end)
+	{
+		column_end	= std::min(column_end, m_column_count_);
+		row_end		= std::min(row_end, m_row_count_);
+		if (column_begin >= column_end || row_begin >= row_end)
+		{
+			return std::vector<int32_t>();
+		}
+
+		// The runs of consecutive rows are stored together, so the region takes a single read.
+		std::vector<LBL_Run> runs(m_row_starts_[row_end] - m_row_starts_[row_begin]);
+		m_in_.clear();
+		m_in_.seekg(m_runs_offset_ + m_row_starts_[row_begin] * sizeof(LBL_Run));
+		m_in_.read((char*)runs.data(), runs.size() * sizeof(LBL_Run));
+		if (!m_in_)
+		{
+			throw Exceptions::FormatError("Label map is truncated: " + m_filepath_);
+		}
+
+		const uint32_t width = column_end - column_begin;
+		std::vector<int32_t> labels((size_t)width * (row_end - row_begin));
+		for (uint32_t row = row_begin; row < row_end; ++row)
+		{
+			int32_t* destination = labels.data() + (size_t)(row - row_begin) * width;
+			uint32_t column = 0;
+			for (uint64_t r = m_row_starts_[row]; r < m_row_starts_[row + 1] && column < column_end; ++r)
+			{
+				const LBL_Run& run = runs[r - m_row_starts_[row_begin]];
+				uint32_t begin = std::max(column, column_begin);
+				uint32_t end = std::min(column + run.length, column_end);
+				if (begin < end)
+				{
+					std::fill(destination + (begin - column_begin), destination + (end - column_begin), run.label);
+				}
+				column += run.length;
+			}
+		}
+
+		return labels;
+	}
+
+	int32_t LBL_Reader::Owner(const uint32_t column, const uint32_t row)
+	{
+		std::vector<int32_t> labels(ReadRegion(column, row, column + 1, row + 1));
+		return labels.empty() ? -1 : labels[0];
+	}
+
+	std::vector<int32_t> LBL_Reader::Owners(const uint32_t column_begin, const uint32_t row_begin, const uint32_t column_end, const uint32_t row_end)
+	{
+		std::vector<int32_t> owners(ReadRegion(column_begin, row_begin, column_end, row_end));
+		std::sort(owners.begin(), owners.end());
+		owners.erase(std::unique(owners.begin(), owners.end()), owners.end());
+		if (!owners.empty() && owners[0] < 0)
+		{
+			owners.erase(owners.begin());
+		}
+		return owners;
+	}
+}
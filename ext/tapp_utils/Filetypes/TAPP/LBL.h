@@ -0,0 +1,105 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+	The LBL file holds the peak label of every cell of a mesh, as left by centroid, so that the peak owning a cell can
+	be looked up without finding the peaks again. The labels are the peak numbers of the PKS or PKB file written
+	alongside, or -1 for cells that belong to no peak.
+
+	Each row is stored as runs of equal labels, preceded by a table with the first run of each row, so that a region
+	of the mesh is read without reading the rest. Cells are addressed by their mesh indices; Mesh::mConversion maps
+	m/z and RT to them. Values are stored in the endianness of the platform that wrote the file.
+*/
+
+namespace TAPP::Filetypes::TAPP
+{
+	/// <summary>Resembles a run of cells of one row sharing a label.</summary>
+	struct LBL_Run
+	{
+		uint32_t	length;
+		int32_t		label;
+	};
+
+	/// <summary>Writes an LBL file row by row.</summary>
+	class LBL_Writer
+	{
+		public:
+			/// <summary>Creates the file, which is complete once all rows are written and Close is called.</summary>
+			/// <param name="filepath">The filepath of the LBL file to write.</param>
+			/// <param name="column_count">The amount of cells in each row.</param>
+			/// <param name="row_count">The amount of rows.</param>
+			/// <param name="peak_count">The amount of peaks the labels refer to.</param>
+			LBL_Writer(const std::string& filepath, const uint32_t column_count, const uint32_t row_count, const uint64_t peak_count);
+
+			/// <summary>Appends the next row.</summary>
+			/// <param name="labels">The column_count labels of the row.</param>
+			void WriteRow(const int32_t* labels);
+
+			/// <summary>Writes the row table and closes the file.</summary>
+			void Close(void);
+
+		private:
+			/*** Variables **************************************************************/
+
+			std::string				m_filepath_;
+			std::ofstream			m_out_;
+			uint32_t				m_column_count_;
+			uint32_t				m_row_count_;
+			uint64_t				m_peak_count_;
+			std::vector<uint64_t>	m_row_starts_;
+			std::vector<LBL_Run>	m_runs_;
+	};
+
+	/// <summary>Looks up the labels of regions of an LBL file, reading only the rows they span.</summary>
+	class LBL_Reader
+	{
+		public:
+			/// <summary>Opens the file and reads its row table.</summary>
+			/// <param name="filepath">The filepath of the LBL file to read.</param>
+			explicit LBL_Reader(const std::string& filepath);
+
+			uint32_t ColumnCount(void) const
+			{
+				return m_column_count_;
+			}
+
+			uint32_t RowCount(void) const
+			{
+				return m_row_count_;
+			}
+
+			uint64_t PeakCount(void) const
+			{
+				return m_peak_count_;
+			}
+
+			/// <summary>Reads the labels of the cells [column_begin, column_end) of the rows [row_begin, row_end), which are clipped to the mesh.</summary>
+			/// <returns>The labels, row after row.</returns>
+			std::vector<int32_t> ReadRegion(uint32_t column_begin, uint32_t row_begin, uint32_t column_end, uint32_t row_end);
+
+			/// <summary>Returns the peak owning a cell, or -1 if there's none or the cell lies outside the mesh.</summary>
+			int32_t Owner(const uint32_t column, const uint32_t row);
+
+			/// <summary>Returns the distinct peaks owning cells of a region, in ascending order.</summary>
+			std::vector<int32_t> Owners(const uint32_t column_begin, const uint32_t row_begin, const uint32_t column_end, const uint32_t row_end);
+
+		private:
+			/*** Variables **************************************************************/
+
+			std::string				m_filepath_;
+			std::ifstream			m_in_;
+			uint32_t				m_column_count_;
+			uint32_t				m_row_count_;
+			uint64_t				m_peak_count_;
+			uint64_t				m_runs_offset_;
+			std::vector<uint64_t>	m_row_starts_;
+	};
+}
@@ -10,6 +10,8 @@
 #include <fstream>
 #include <functional>
 
+#include "Filetypes/TAPP/TAPP_Output.h"
+
 namespace TAPP::Filetypes::TAPP
 {
 	Filetypes::DSV::Parser<MPKS> Create_MPKS_Parser(const Filetypes::DSV::Grammar grammar, const size_t buffer_size)
@@ -99,7 +101,7 @@ namespace TAPP::Filetypes::TAPP
 		return MPKS_files;
 	}
 
-	void WriteMPKS(std::ostream& out, const std::vector<MPKS>& records, const Filetypes::DSV::Grammar grammar, const bool output_header)
+	void WriteMPKS(std::ostream& out, const std::vector<MPKS>& records, const Filetypes::DSV::Grammar grammar, const bool output_header, const size_t thread_count)
 	{
 		// Writes the header.
 		if (output_header)
@@ -129,33 +131,44 @@ namespace TAPP::Filetypes::TAPP
 		}
 
 		// Writes the data.
-		for (const MPKS& record : records)
+		WriteRecords(out, records, [grammar](TextFormatter& text, const MPKS& record)
 		{
-			out									<< record.id													<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.mz					<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.rt					<< grammar.value_encapsulation	<< grammar.value_delimiter
-												<< record.number_of_peaks										<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.mz_sigma				<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.rt_sigma				<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.mz_weighted_sigma		<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.rt_weighted_sigma		<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.intensity				<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.volume				<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.extreme_fold_ratio	<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.extreme_class			<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.mz					<< grammar.value_encapsulation	<< grammar.value_delimiter;
+			// Appends an encapsulated floating point value.
+			auto append_value = [&text, &grammar](const double value)
+			{
+				text.AppendChar(grammar.value_encapsulation);
+				text.AppendDouble(value);
+				text.AppendChar(grammar.value_encapsulation);
+				text.AppendChar(grammar.value_delimiter);
+			};
+
+			text.AppendInteger(record.id);				text.AppendChar(grammar.value_delimiter);
+			append_value(record.mz);
+			append_value(record.rt);
+			text.AppendInteger(record.number_of_peaks);	text.AppendChar(grammar.value_delimiter);
+			append_value(record.mz_sigma);
+			append_value(record.rt_sigma);
+			append_value(record.mz_weighted_sigma);
+			append_value(record.rt_weighted_sigma);
+			append_value(record.intensity);
+			append_value(record.volume);
+			append_value(record.extreme_fold_ratio);
+			append_value(record.extreme_class);
+			append_value(record.mz);
 
 			for (double class_value : record.class_values)
 			{
-				out << class_value << grammar.value_delimiter;
+				text.AppendDouble(class_value);
+				text.AppendChar(grammar.value_delimiter);
 			}
 
 			for (double file_value : record.file_values)
 			{
-				out << file_value << grammar.value_delimiter;
+				text.AppendDouble(file_value);
+				text.AppendChar(grammar.value_delimiter);
 			}
 
-			out << grammar.record_delimiter;
-		}
+			text.AppendChar(grammar.record_delimiter);
+		}, thread_count);
 	}
 }
@@ -8,6 +8,8 @@
 #include <fstream>
 #include <functional>
 
+#include "Filetypes/TAPP/TAPP_Output.h"
+
 namespace TAPP::Filetypes::TAPP
 {
 	Filetypes::DSV::Parser<PID> Create_PID_Parser(const Filetypes::DSV::Grammar grammar, const size_t buffer_size)
@@ -63,7 +65,7 @@ namespace TAPP::Filetypes::TAPP
 		return PID_files;
 	}
 
-	void WritePID(std::ostream& out, const std::vector<PID>& records, const Filetypes::DSV::Grammar grammar, const bool output_header)
+	void WritePID(std::ostream& out, const std::vector<PID>& records, const Filetypes::DSV::Grammar grammar, const bool output_header, const size_t thread_count)
 	{
 		// Writes the header.
 		if (output_header)
@@ -79,16 +81,25 @@ namespace TAPP::Filetypes::TAPP
 		}
 
 		// Writes the data.
-		for (const PID& record : records)
+		WriteRecords(out, records, [grammar](TextFormatter& text, const PID& record)
 		{
-			out									<< record.metapeak_id												<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.mz						<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.rt						<< grammar.value_encapsulation	<< grammar.value_delimiter
-				<< grammar.value_encapsulation	<< record.intensity					<< grammar.value_encapsulation	<< grammar.value_delimiter
-												<< std::to_string(record.file_id)									<< grammar.value_delimiter
-												<< record.peak_id													<< grammar.value_delimiter
-												<< std::to_string(record.class_id)									<< grammar.value_delimiter
-				<< grammar.record_delimiter;
-		}
+			// Appends an encapsulated floating point value.
+			auto append_value = [&text, &grammar](const double value)
+			{
+				text.AppendChar(grammar.value_encapsulation);
+				text.AppendDouble(value);
+				text.AppendChar(grammar.value_encapsulation);
+				text.AppendChar(grammar.value_delimiter);
+			};
+
+			text.AppendInteger(record.metapeak_id);	text.AppendChar(grammar.value_delimiter);
+			append_value(record.mz);
+			append_value(record.rt);
+			append_value(record.intensity);
+			text.AppendInteger(record.file_id);		text.AppendChar(grammar.value_delimiter);
+			text.AppendInteger(record.peak_id);		text.AppendChar(grammar.value_delimiter);
+			text.AppendInteger(record.class_id);	text.AppendChar(grammar.value_delimiter);
+			text.AppendChar(grammar.record_delimiter);
+		}, thread_count);
 	}
 }
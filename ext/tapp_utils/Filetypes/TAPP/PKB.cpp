@@ -0,0 +1,354 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#include "Filetypes/TAPP/PKB.h"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "Exceptions/FileAccessError.h"
+#include "Exceptions/FormatError.h"
+#include "Mesh/FSUtil.h"
+
+namespace TAPP::Filetypes::TAPP
+{
+	const static char		PKB_MAGIC[4]	= { 'T', 'P', 'K', 'B' };
+	const static uint32_t	PKB_VERSION		= 1;
+
+	struct PKB_Header
+	{
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	little_endian;
+		uint32_t	column_count;
+		uint64_t	record_count;
+	};
+
+	struct PKB_ColumnEntry
+	{
+		uint32_t	column;
+		uint32_t	compression;
+		uint64_t	offset;
+		uint64_t	size;
+	};
+
+	static_assert(sizeof(PKB_Header) % 8 == 0 && sizeof(PKB_ColumnEntry) % 8 == 0, "PKB tables must keep the columns 8 byte aligned.");
+
+	// Links the columns to the fields they are stored in.
+	const static std::pair<PKB_Column, size_t PKS::*> INTEGER_COLUMNS[] =
+	{
+		{ PKB_ID, &PKS::id }, { PKB_COUNT, &PKS::count }
+	};
+
+	const static std::pair<PKB_Column, double PKS::*> DOUBLE_COLUMNS[] =
+	{
+		{ PKB_MZ, &PKS::mz }, { PKB_RT, &PKS::rt }, { PKB_HEIGHT, &PKS::intensity }, { PKB_VOLUME, &PKS::volume },
+		{ PKB_V_CENTROID, &PKS::v_centroid }, { PKB_MZ_SIGMA, &PKS::mz_sigma }, { PKB_RT_SIGMA, &PKS::rt_sigma },
+		{ PKB_LOCAL_BACKGROUND, &PKS::local_background }, { PKB_SN_VOLUME, &PKS::sn_volume },
+		{ PKB_SN_HEIGHT, &PKS::sn_height }, { PKB_SN_CENTROID, &PKS::sn_centroid }
+	};
+
+	const static std::pair<PKB_Column, double PKB_Bounds::*> BOUNDS_COLUMNS[] =
+	{
+		{ PKB_MZ_MIN, &PKB_Bounds::mz_min }, { PKB_MZ_MAX, &PKB_Bounds::mz_max },
+		{ PKB_RT_MIN, &PKB_Bounds::rt_min }, { PKB_RT_MAX, &PKB_Bounds::rt_max }
+	};
+
+	// Holds the contents of a file, mapped where the platform allows it and read otherwise.
+	class FileView
+	{
+		public:
+			explicit FileView(const std::string& filepath) : m_mapped_(nullptr), m_size_(0)
+			{
+				std::ifstream in(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+				if (!in.is_open())
+				{
+					throw Exceptions::FileAccessError("Unable to open PKB file: " + filepath);
+				}
+				m_size_ = (size_t)in.tellg();
+
+				m_mapped_ = FSUtil::MapFile<char>(filepath.c_str(), m_size_);
+				if (!m_mapped_)
+				{
+					m_buffer_.resize(m_size_);
+					in.seekg(0);
+					in.read(m_buffer_.data(), m_size_);
+				}
+			}
+
+			~FileView(void)
+			{
+				if (m_mapped_)
+				{
+					FSUtil::UnmapFile(m_mapped_, m_size_);
+				}
+			}
+
+			FileView(const FileView&) = delete;
+			FileView& operator=(const FileView&) = delete;
+
+			const char* data(void) const
+			{
+				return m_mapped_ ? m_mapped_ : m_buffer_.data();
+			}
+
+			size_t size(void) const
+			{
+				return m_size_;
+			}
+
+		private:
+			char*				m_mapped_;
+			size_t				m_size_;
+			std::vector<char>	m_buffer_;
+	};
+
+	// Stores integers as zigzagged differences to the previous value, in 7 bit groups.
+	static std::vector<char> EncodeDeltaVarint(const std::vector<uint64_t>& values)
+	{
+		std::vector<char> bytes;
+		bytes.reserve(values.size());
+
+		uint64_t previous = 0;
+		for (uint64_t value : values)
+		{
+			int64_t delta = (int64_t)(value - previous);
+			uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+			previous = value;
+
+			while (zigzag >= 0x80)
+			{
+				bytes.push_back((char)((zigzag & 0x7f) | 0x80));
+				zigzag >>= 7;
+			}
+			bytes.push_back((char)zigzag);
+		}
+
+		return bytes;
+	}
+
+	static std::vector<uint64_t> DecodeDeltaVarint(const char* bytes, const size_t size, const size_t count)
+	{
+		std::vector<uint64_t> values;
+		values.reserve(count);
+
+		uint64_t previous = 0;
+		size_t position = 0;
+		while (values.size() < count && position < size)
+		{
+			uint64_t zigzag = 0;
+			for (int shift = 0; position < size && shift < 64; shift += 7)
+			{
+				unsigned char byte = (unsigned char)bytes[position++];
+				zigzag |= (uint64_t)(byte & 0x7f) << shift;
+				if (!(byte & 0x80))
+				{
+					break;
+				}
+			}
+			previous += (uint64_t)((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+			values.push_back(previous);
+		}
+
+		if (values.size() != count)
+		{
+			throw Exceptions::FormatError("PKB integer column is truncated.");
+		}
+
+		return values;
+	}
+
+	template <typename T>
+	static std::vector<char> RawBytes(const std::vector<T>& values)
+	{
+		std::vector<char> bytes(values.size() * sizeof(T));
+		if (!values.empty())
+		{
+			memcpy(bytes.data(), values.data(), bytes.size());
+		}
+		return bytes;
+	}
+
+	bool IsPKB(const std::string& filepath)
+	{
+		char magic[4];
+		std::ifstream in(filepath, std::ios::in | std::ios::binary);
+		return in.read(magic, sizeof(magic)) && memcmp(magic, PKB_MAGIC, sizeof(magic)) == 0;
+	}
+
+	PKB_File ParsePKB(const std::string& filepath)
+	{
+		FileView file(filepath);
+
+		PKB_Header header;
+		if (file.size() < sizeof(header))
+		{
+			throw Exceptions::FormatError("Not a PKB file: " + filepath);
+		}
+		memcpy(&header, file.data(), sizeof(header));
+		if (memcmp(header.magic, PKB_MAGIC, sizeof(PKB_MAGIC)) != 0 || header.version != PKB_VERSION)
+		{
+			throw Exceptions::FormatError("Not a PKB file: " + filepath);
+		}
+		if (header.little_endian != FS_LITTLEENDIAN)
+		{
+			throw Exceptions::FormatError("PKB file was written on an incompatible platform: " + filepath);
+		}
+		// Every record takes at least a byte in each column, which bounds the count before the records are allocated.
+		if (sizeof(header) + (uint64_t)header.column_count * sizeof(PKB_ColumnEntry) > file.size() ||
+			header.record_count > (uint64_t)(file.size() - sizeof(header)))
+		{
+			throw Exceptions::FormatError("PKB file is truncated: " + filepath);
+		}
+
+		PKB_File pkb;
+		pkb.records.resize(header.record_count, PKS());
+		pkb.bounds.resize(header.record_count, PKB_Bounds());
+
+		const size_t count = header.record_count;
+		for (uint32_t c = 0; c < header.column_count; ++c)
+		{
+			PKB_ColumnEntry entry;
+			memcpy(&entry, file.data() + sizeof(header) + c * sizeof(entry), sizeof(entry));
+			if (entry.offset > file.size() || entry.size > file.size() - entry.offset)
+			{
+				throw Exceptions::FormatError("PKB file is truncated: " + filepath);
+			}
+			const char* data = file.data() + entry.offset;
+
+			for (const auto& column : INTEGER_COLUMNS)
+			{
+				if (column.first != entry.column)
+				{
+					continue;
+				}
+
+				std::vector<uint64_t> values;
+				if (entry.compression == PKB_DELTA_VARINT)
+				{
+					values = DecodeDeltaVarint(data, entry.size, count);
+				}
+				else if (entry.compression == PKB_RAW && entry.size == count * sizeof(uint64_t))
+				{
+					values.resize(count);
+					memcpy(values.data(), data, entry.size);
+				}
+				else
+				{
+					throw Exceptions::FormatError("PKB integer column has an unexpected layout: " + filepath);
+				}
+
+				for (size_t r = 0; r < count; ++r)
+				{
+					pkb.records[r].*column.second = values[r];
+				}
+			}
+
+			// Floating point columns are always raw, so they are read straight from the file.
+			auto read_doubles = [&](auto& records, const auto& columns)
+			{
+				for (const auto& column : columns)
+				{
+					if (column.first != entry.column)
+					{
+						continue;
+					}
+					if (entry.compression != PKB_RAW || entry.size != count * sizeof(double))
+					{
+						throw Exceptions::FormatError("PKB column has an unexpected layout: " + filepath);
+					}
+					for (size_t r = 0; r < count; ++r)
+					{
+						memcpy(&(records[r].*column.second), data + r * sizeof(double), sizeof(double));
+					}
+				}
+			};
+			read_doubles(pkb.records, DOUBLE_COLUMNS);
+			read_doubles(pkb.bounds, BOUNDS_COLUMNS);
+		}
+
+		return pkb;
+	}
+
+	void WritePKB(const std::string& filepath, const std::vector<PKS>& records, const std::vector<PKB_Bounds>& bounds, const bool compress)
+	{
+		std::ofstream out(filepath, std::ios::out | std::ios::binary);
+		if (!out.is_open())
+		{
+			throw Exceptions::FileAccessError("Unable to open PKB file for writing: " + filepath);
+		}
+
+		// Gathers the stored form of each column.
+		std::vector<std::pair<PKB_ColumnEntry, std::vector<char>>> columns;
+		for (const auto& column : INTEGER_COLUMNS)
+		{
+			std::vector<uint64_t> values;
+			values.reserve(records.size());
+			for (const PKS& record : records)
+			{
+				values.push_back(record.*column.second);
+			}
+			columns.push_back({ { column.first, compress ? PKB_DELTA_VARINT : PKB_RAW, 0, 0 }, compress ? EncodeDeltaVarint(values) : RawBytes(values) });
+		}
+		for (const auto& column : DOUBLE_COLUMNS)
+		{
+			std::vector<double> values;
+			values.reserve(records.size());
+			for (const PKS& record : records)
+			{
+				values.push_back(record.*column.second);
+			}
+			columns.push_back({ { column.first, PKB_RAW, 0, 0 }, RawBytes(values) });
+		}
+		if (!bounds.empty())
+		{
+			for (const auto& column : BOUNDS_COLUMNS)
+			{
+				std::vector<double> values;
+				values.reserve(bounds.size());
+				for (const PKB_Bounds& bound : bounds)
+				{
+					values.push_back(bound.*column.second);
+				}
+				columns.push_back({ { column.first, PKB_RAW, 0, 0 }, RawBytes(values) });
+			}
+		}
+
+		// Lays the columns out after the tables, each one on an 8 byte boundary.
+		uint64_t offset = sizeof(PKB_Header) + columns.size() * sizeof(PKB_ColumnEntry);
+		for (auto& column : columns)
+		{
+			column.first.offset = offset;
+			column.first.size = column.second.size();
+			offset += (column.first.size + 7) / 8 * 8;
+		}
+
+		PKB_Header header;
+		memcpy(header.magic, PKB_MAGIC, sizeof(PKB_MAGIC));
+		header.version		= PKB_VERSION;
+		header.little_endian	= FS_LITTLEENDIAN;
+		header.column_count	= columns.size();
+		header.record_count	= records.size();
+
+		out.write((const char*)&header, sizeof(header));
+		for (const auto& column : columns)
+		{
+			out.write((const char*)&column.first, sizeof(column.first));
+		}
+
+		const char padding[8] = { 0 };
+		for (const auto& column : columns)
+		{
+			out.write(column.second.data(), column.second.size());
+			out.write(padding, (8 - column.second.size() % 8) % 8);
+		}
+
+		if (!out)
+		{
+			throw Exceptions::FileAccessError("Unable to write PKB file: " + filepath);
+		}
+	}
+}
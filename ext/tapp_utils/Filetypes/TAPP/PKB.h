@@ -0,0 +1,86 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Filetypes/TAPP/PKS.h"
+
+/*
+	The PKB file is a binary, columnar counterpart of the PKS file. It holds a header, a table describing each
+	column and the columns themselves, each one starting at an 8 byte boundary so that it can be used in place
+	when the file is mapped. Values are stored in the endianness of the platform that wrote the file.
+
+	Each column carries a compression flag. Floating point columns are always stored raw, integer columns
+	may be delta and variable length encoded.
+*/
+
+namespace TAPP::Filetypes::TAPP
+{
+	/// <summary>Identifies a column within a PKB file.</summary>
+	enum PKB_Column : uint32_t
+	{
+		PKB_ID,
+		PKB_MZ,
+		PKB_RT,
+		PKB_HEIGHT,
+		PKB_VOLUME,
+		PKB_V_CENTROID,
+		PKB_MZ_SIGMA,
+		PKB_RT_SIGMA,
+		PKB_COUNT,
+		PKB_LOCAL_BACKGROUND,
+		PKB_SN_VOLUME,
+		PKB_SN_HEIGHT,
+		PKB_SN_CENTROID,
+		PKB_MZ_MIN,
+		PKB_MZ_MAX,
+		PKB_RT_MIN,
+		PKB_RT_MAX,
+		PKB_COLUMN_COUNT
+	};
+
+	/// <summary>Identifies how a column is stored.</summary>
+	enum PKB_Compression : uint32_t
+	{
+		PKB_RAW,
+		PKB_DELTA_VARINT
+	};
+
+	/// <summary>Resembles the bounding box of a peak, in m/z and RT.</summary>
+	struct PKB_Bounds
+	{
+		double mz_min;
+		double mz_max;
+		double rt_min;
+		double rt_max;
+	};
+
+	/// <summary>Resembles the contents of a PKB file.</summary>
+	struct PKB_File
+	{
+		std::vector<PKS>		records;
+		std::vector<PKB_Bounds>	bounds;
+	};
+
+	/// <summary>Checks whether the file at the passed filepath is a PKB file.</summary>
+	/// <param name="filepath">The filepath of the file to check.</param>
+	/// <returns>Whether or not the file starts with the PKB signature.</returns>
+	bool IsPKB(const std::string& filepath);
+
+	/// <summary>Parses a PKB file located at the passed filepath, mapping it into memory where possible.</summary>
+	/// <param name="filepath">The filepath corresponding to the PKB file to parse.</param>
+	/// <returns>The records and bounding boxes held by the file. Columns missing from the file are left at zero.</returns>
+	PKB_File ParsePKB(const std::string& filepath);
+
+	/// <summary>Writes PKS records and their bounding boxes into a PKB file.</summary>
+	/// <param name="filepath">The filepath of the PKB file to write.</param>
+	/// <param name="records">The records to write into the file.</param>
+	/// <param name="bounds">The bounding box of each record, or an empty vector to leave the bounds at zero.</param>
+	/// <param name="compress">Whether or not to encode the integer columns.</param>
+	void WritePKB(const std::string& filepath, const std::vector<PKS>& records, const std::vector<PKB_Bounds>& bounds, const bool compress);
+}
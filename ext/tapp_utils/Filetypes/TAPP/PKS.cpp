@@ -8,6 +8,9 @@
 #include <fstream>
 #include <functional>
 
+#include "Filetypes/TAPP/PKB.h"
+#include "Filetypes/TAPP/TAPP_Output.h"
+
 // TODO: Implement Boost Lexical casts to convert iterators to values, rather than have the conversion to string at intermediary string.
 
 namespace TAPP::Filetypes::TAPP
@@ -47,6 +50,12 @@ namespace TAPP::Filetypes::TAPP
 
 	std::vector<PKS> ParsePKS(const std::string filepath, const Filetypes::DSV::Grammar grammar, const size_t buffer_size)
 	{
+		// Binary peak lists are read directly.
+		if (IsPKB(filepath))
+		{
+			return ParsePKB(filepath).records;
+		}
+
 		// Acquires the parser.
 		Filetypes::DSV::Parser<PKS> parser(Create_PKS_Parser(grammar, buffer_size));
 
@@ -65,13 +74,13 @@ namespace TAPP::Filetypes::TAPP
 		// Loops through each file, parsing it into the vector.
 		for (const std::string& filepath : filepaths)
 		{
-			PKS_files.push_back(parser.Parse(filepath));
+			PKS_files.push_back(IsPKB(filepath) ? ParsePKB(filepath).records : parser.Parse(filepath));
 		}
 
 		return PKS_files;
 	}
 
-	void WritePKS(std::ostream& out, const std::vector<PKS>& records, const Filetypes::DSV::Grammar grammar, const bool output_header)
+	void WritePKS(std::ostream& out, const std::vector<PKS>& records, const Filetypes::DSV::Grammar grammar, const bool output_header, const size_t thread_count)
 	{
 		// Writes the header.
 		if (output_header)
@@ -87,22 +96,22 @@ namespace TAPP::Filetypes::TAPP
 		}
 
 		// Writes the data.
-		for (const PKS& record : records)
+		WriteRecords(out, records, [grammar](TextFormatter& text, const PKS& record)
 		{
-			out<< record.id					<< grammar.value_delimiter
-					<< record.mz					<< grammar.value_delimiter
-					<< record.rt					<< grammar.value_delimiter
-					<< record.intensity				<< grammar.value_delimiter
-					<< record.volume				<< grammar.value_delimiter
-					<< record.v_centroid			<< grammar.value_delimiter
-					<< record.mz_sigma				<< grammar.value_delimiter
-					<< record.rt_sigma				<< grammar.value_delimiter
-												<< record.count												<< grammar.value_delimiter
-					<< record.local_background		<< grammar.value_delimiter
-					<< record.sn_volume				<< grammar.value_delimiter
-					<< record.sn_height				<< grammar.value_delimiter
-					<< record.sn_centroid			<< grammar.value_delimiter
-				<< grammar.record_delimiter;
-		}
+			text.AppendInteger(record.id);				text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.mz);				text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.rt);				text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.intensity);		text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.volume);			text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.v_centroid);		text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.mz_sigma);			text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.rt_sigma);			text.AppendChar(grammar.value_delimiter);
+			text.AppendInteger(record.count);			text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.local_background);	text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.sn_volume);		text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.sn_height);		text.AppendChar(grammar.value_delimiter);
+			text.AppendDouble(record.sn_centroid);		text.AppendChar(grammar.value_delimiter);
+			text.AppendChar(grammar.record_delimiter);
+		}, thread_count);
 	}
 }
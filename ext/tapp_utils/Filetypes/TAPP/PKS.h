@@ -35,7 +35,7 @@ namespace TAPP::Filetypes::TAPP
 	/// <returns>A parser that can read PKS filestreams.</returns>
 	Filetypes::DSV::Parser<PKS> Create_PKS_Parser(const Filetypes::DSV::Grammar grammar, const size_t buffer_size);
 
-	/// <summary>Parses a PKS file located at the passed filepath.</summary>
+	/// <summary>Parses a PKS file located at the passed filepath. PKB files are recognized and read as well.</summary>
 	/// <param name="filepath">The filepath corresponding to the PKS file to parse.</param>
 	/// <param name="grammar">The data separated value grammar for the PKS file.</param>
 	/// <param name="buffer_size">The maximum amount of buffered characters.</param>
@@ -54,5 +54,6 @@ namespace TAPP::Filetypes::TAPP
 	/// <param name="records">The records to write into the outstream.</param>
 	/// <param name="grammar">The data separated value grammar for the IPL file.</param>
 	/// <param name="output_header">Whether or not to write the header into the outstream.</param>
-	void WritePKS(std::ostream& out, const std::vector<PKS>& records, const Filetypes::DSV::Grammar grammar, const bool output_header);
+	/// <param name="thread_count">The amount of threads formatting the records, 0 for one per core. The records are written in order either way.</param>
+	void WritePKS(std::ostream& out, const std::vector<PKS>& records, const Filetypes::DSV::Grammar grammar, const bool output_header, const size_t thread_count = 0);
 }
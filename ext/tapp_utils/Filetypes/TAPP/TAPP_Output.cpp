@@ -11,4 +11,36 @@ namespace TAPP::Filetypes::TAPP
 	{
 		out.precision(TAPP_OUTPUT_PRECISION);
 	}
+
+	TextFormatter::TextFormatter(const std::ostream& out) : m_precision_(out.precision())
+	{
+		// Mirrors the printf conversion a stream picks for its floatfield.
+		switch (out.flags() & std::ios_base::floatfield)
+		{
+			case std::ios_base::fixed:		m_format_ = std::chars_format::fixed;		break;
+			case std::ios_base::scientific:	m_format_ = std::chars_format::scientific;	break;
+			default:						m_format_ = std::chars_format::general;		break;
+		}
+	}
+
+	void TextFormatter::AppendDouble(const double value)
+	{
+		// Large enough for any fixed notation double at the usual precisions, longer results are retried in a larger buffer.
+		char digits[512];
+		std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value, m_format_, m_precision_);
+		if (result.ec == std::errc())
+		{
+			m_text_.append(digits, result.ptr);
+			return;
+		}
+
+		std::string large(sizeof(digits), '\0');
+		do
+		{
+			large.resize(large.size() * 2);
+			result = std::to_chars(large.data(), large.data() + large.size(), value, m_format_, m_precision_);
+		}
+		while (result.ec != std::errc());
+		m_text_.append(large.data(), result.ptr);
+	}
 }
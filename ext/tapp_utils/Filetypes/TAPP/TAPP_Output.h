@@ -4,11 +4,103 @@
 // the LICENSE.md file in the root directory of this source tree.
 
 #pragma once
+#include <algorithm>
+#include <charconv>
 #include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Utilities/Parallel.hpp"
 
 namespace TAPP::Filetypes::TAPP
 {
 	const static char TAPP_OUTPUT_PRECISION = 10;
 
 	void SetGlobalPrecision(std::ostream& out);
-}
\ No newline at end of file
+
+	/// <summary>
+	/// Appends the text of values to a character buffer through std::to_chars. Floating point values are formatted the
+	/// way the stream the formatter was created for would format them, following its precision and floatfield.
+	/// </summary>
+	class TextFormatter
+	{
+		public:
+			/// <summary>Creates a formatter that follows the floating point settings of a stream.</summary>
+			/// <param name="out">The stream whose precision and floatfield are copied.</param>
+			TextFormatter(const std::ostream& out);
+
+			void AppendDouble(const double value);
+
+			/// <summary>Appends an integer as a number, also when it's a char type.</summary>
+			template <typename Integer>
+			void AppendInteger(const Integer value)
+			{
+				char digits[24];
+				m_text_.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+			}
+
+			void AppendChar(const char character)
+			{
+				m_text_.push_back(character);
+			}
+
+			void AppendString(const std::string_view string)
+			{
+				m_text_.append(string);
+			}
+
+			/// <summary>Discards the text, keeping the allocated buffer.</summary>
+			void clear(void)
+			{
+				m_text_.clear();
+			}
+
+			const std::string& Text(void) const
+			{
+				return m_text_;
+			}
+
+		private:
+			std::chars_format	m_format_;
+			int					m_precision_;
+			std::string			m_text_;
+	};
+
+	/// <summary>Formats records into text in chunks spread over several threads, writing the chunks to the stream in record order.</summary>
+	/// <param name="out">The outstream to which the records will be written.</param>
+	/// <param name="records">The records to write into the outstream.</param>
+	/// <param name="format">A callable accepting a TextFormatter and a record, which appends the text of the record.</param>
+	/// <param name="thread_count">The amount of threads formatting records, 0 for one per core.</param>
+	template <typename Record, typename Format>
+	void WriteRecords(std::ostream& out, const std::vector<Record>& records, Format format, size_t thread_count = 0)
+	{
+		const size_t chunk_size		= 4096;
+		const size_t chunk_count	= (records.size() + chunk_size - 1) / chunk_size;
+
+		// Formats a few chunks per thread at a time, which bounds the text held in memory. The buffers are reused between batches.
+		thread_count = Utilities::ResolveThreadCount(thread_count);
+		std::vector<TextFormatter> buffers(std::min(chunk_count, thread_count * 4), TextFormatter(out));
+		for (size_t batch_start = 0; batch_start < chunk_count; batch_start += buffers.size())
+		{
+			size_t batch_chunks = std::min(buffers.size(), chunk_count - batch_start);
+			Utilities::ParallelFor(batch_chunks, thread_count, [&](const size_t chunk)
+			{
+				TextFormatter& buffer = buffers[chunk];
+				buffer.clear();
+
+				size_t begin	= (batch_start + chunk) * chunk_size;
+				size_t end		= std::min(begin + chunk_size, records.size());
+				for (size_t r = begin; r < end; ++r)
+				{
+					format(buffer, records[r]);
+				}
+			});
+
+			for (size_t chunk = 0; chunk < batch_chunks; ++chunk)
+			{
+				out.write(buffers[chunk].Text().data(), buffers[chunk].Text().size());
+			}
+		}
+	}
+}
@@ -0,0 +1,106 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "External/Midas/MIDAs.h"
+#include "MassSpectrometry/Isotope/Averagine.h"
+
+namespace TAPP::MassSpectrometry::Isotope
+{
+	/*
+		Holds the theoretical isotope distributions calculated by MIDAs, so that each one is only calculated once per run.
+		The cache is filled lazily, a distribution is calculated when it's first asked for.
+
+		Averagine rounds the atom counts of a mass, which places every mass in a bin of a few daltons sharing one
+		composition and thus one distribution. The cache is keyed on that composition and the charge state, so a lookup
+		returns exactly what MIDAs would have, without interpolating between bins.
+	*/
+	class DistributionCache
+	{
+		public:
+			typedef std::vector<Isotopic_Distribution> DistributionTable;
+
+			/*** Constructors / Destructor **********************************************/
+
+			DistributionCache(unsigned char midas_mode = 1) : m_midas_mode_(midas_mode), m_averagine_table_(CreateAveragineTable())
+			{
+			}
+
+			/*** Functions **************************************************************/
+
+			/// <summary>Returns the distribution of an elemental composition or peptide sequence, calculating it when it's first asked for.</summary>
+			/// <param name="sequence">The composition or sequence, as passed to MIDAs.</param>
+			/// <param name="chargestate">The charge state of the ion.</param>
+			/// <returns>A reference to the distribution, which stays valid for the lifetime of the cache.</returns>
+			const DistributionTable& Get(const std::string& sequence, const unsigned char chargestate)
+			{
+				std::string key(Key_(sequence, chargestate));
+				{
+					std::lock_guard<std::mutex> lock(m_mutex_);
+					auto distribution = m_distributions_.find(key);
+					if (distribution != m_distributions_.end())
+					{
+						return distribution->second;
+					}
+				}
+
+				// MIDAs isn't known to be reentrant, so distributions are calculated one at a time, while cached ones are still
+				// returned meanwhile. The cache is checked again, as another thread may have calculated the distribution first.
+				std::lock_guard<std::mutex> midas_lock(m_midas_mutex_);
+				{
+					std::lock_guard<std::mutex> lock(m_mutex_);
+					auto distribution = m_distributions_.find(key);
+					if (distribution != m_distributions_.end())
+					{
+						return distribution->second;
+					}
+				}
+
+				MIDAs midas(chargestate, 1, 1, 1e-150, m_midas_mode_);
+				midas.Initialize_Elemental_Composition(sequence, "", "H", "OH", 1);
+				DistributionTable distribution(midas.Fine_Grained_Isotopic_Distribution());
+
+				std::lock_guard<std::mutex> lock(m_mutex_);
+				return m_distributions_.insert({ key, std::move(distribution) }).first->second;
+			}
+
+			/// <summary>Returns the distribution of the Averagine composition of a mass.</summary>
+			/// <param name="mass">The neutral mass of the ion.</param>
+			/// <param name="chargestate">The charge state of the ion.</param>
+			const DistributionTable& GetAveragine(const double mass, const unsigned char chargestate)
+			{
+				return Get(Averagine(m_averagine_table_, mass), chargestate);
+			}
+
+			/// <summary>Returns the amount of distributions held by the cache.</summary>
+			size_t size(void)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex_);
+				return m_distributions_.size();
+			}
+
+		private:
+			/*** Variables **************************************************************/
+
+			unsigned char										m_midas_mode_;
+			std::vector<std::pair<char, double>>				m_averagine_table_;
+			std::mutex											m_mutex_;
+			inline static std::mutex							m_midas_mutex_;
+			std::unordered_map<std::string, DistributionTable>	m_distributions_;
+
+			/*** Functions **************************************************************/
+
+			static std::string Key_(const std::string& sequence, const unsigned char chargestate)
+			{
+				return std::to_string(chargestate) + '/' + sequence;
+			}
+	};
+}
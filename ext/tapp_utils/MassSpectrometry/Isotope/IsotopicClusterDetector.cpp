@@ -5,11 +5,13 @@
 
 #include "MassSpectrometry/Isotope/IsotopicClusterDetector.h"  // loads midas.h
 
+#include <algorithm>
 #include <cmath>
 #include <unordered_map>
 
 #include "MassSpectrometry/Isotope/Averagine.h"
 #include "MassSpectrometry/CommonSortings.h"
+#include "Utilities/Parallel.hpp"
 
 using namespace std;
 using namespace TAPP::Filetypes::FileRelations;
@@ -18,8 +20,9 @@ namespace TAPP::MassSpectrometry::Isotope
 {
 	/*** Constructors ***********************************************************/
 
-	IsotopicClusterDetector::IsotopicClusterDetector(double error_tolerance, double mz_sigma_range, double rt_sigma_range, unsigned char max_chargestate, unsigned char midas_mode)
-		: m_error_tolerance_(error_tolerance), m_midas_mode_(midas_mode), m_mz_sigma_range_(mz_sigma_range), m_rt_sigma_range_(rt_sigma_range), m_max_chargestate_(max_chargestate)
+	IsotopicClusterDetector::IsotopicClusterDetector(double error_tolerance, double mz_sigma_range, double rt_sigma_range, unsigned char max_chargestate, unsigned char midas_mode, size_t thread_count)
+		: m_error_tolerance_(error_tolerance), m_midas_mode_(midas_mode), m_mz_sigma_range_(mz_sigma_range), m_rt_sigma_range_(rt_sigma_range), m_max_chargestate_(max_chargestate),
+		m_thread_count_(thread_count), m_distributions_(midas_mode), m_grid_rt_min_(0), m_grid_rt_width_(1)
 	{
 	}
 
@@ -35,7 +38,7 @@ namespace TAPP::MassSpectrometry::Isotope
 		std::cout.setstate(std::ios_base::failbit);
 
 		m_averagine_table_ = TAPP::MassSpectrometry::Isotope::CreateAveragineTable();
-		CreateOrderedList_(peak_list);
+		CreateGrid_(peak_list);
 
 		// Initializes the initial vector which will be concatenated with the additional information.
 		vector<IsotopicCluster> clusters;
@@ -56,7 +59,8 @@ namespace TAPP::MassSpectrometry::Isotope
 		}
 
 		m_averagine_table_.clear();
-		m_rt_ordered_peaks_.clear();
+		m_grid_peaks_.clear();
+		m_grid_offsets_.clear();
 
 		// Enables output once again.
 		std::cout.clear();
@@ -66,32 +70,80 @@ namespace TAPP::MassSpectrometry::Isotope
 
 	/*** Private Functions ******************************************************/
 
-	// Creates and orders a mz vector and rt map.
-	void IsotopicClusterDetector::CreateOrderedList_(vector<PeakToEventsRelation>& peak_list)
+	// Places the peaks in RT bins about as wide as the RT range of a query, sorted on m/z within each bin.
+	void IsotopicClusterDetector::CreateGrid_(vector<PeakToEventsRelation>& peak_list)
 	{
-		// Creates a sorted mz ordered peak list.
-		m_rt_ordered_peaks_.reserve(peak_list.size());
+		vector<PeakToEventsRelation*> peaks;
+		vector<double> query_heights;
+		peaks.reserve(peak_list.size());
+		query_heights.reserve(peak_list.size());
 		for (PeakToEventsRelation& peak : peak_list)
 		{
-			m_rt_ordered_peaks_.push_back(&peak);
+			if (peak.peak != nullptr)
+			{
+				peaks.push_back(&peak);
+				query_heights.push_back(2 * peak.peak->mYSig * m_rt_sigma_range_);
+			}
 		}
-		//sort(m_mz_ordered_peaks_.begin(), m_mz_ordered_peaks_.end(), AscendingMassToCharge);
 
-		sort(m_rt_ordered_peaks_.begin(), m_rt_ordered_peaks_.end(), [](PeakToEventsRelation* a, PeakToEventsRelation* b)
+		m_grid_peaks_.clear();
+		m_grid_offsets_.assign(2, 0);
+		m_grid_rt_min_		= 0;
+		m_grid_rt_width_	= 1;
+		if (peaks.empty())
+		{
+			return;
+		}
+
+		auto rt_range = minmax_element(peaks.begin(), peaks.end(), [](PeakToEventsRelation* a, PeakToEventsRelation* b)
 		{
 			return a->peak->mY < b->peak->mY;
 		});
+		m_grid_rt_min_ = (*rt_range.first)->peak->mY;
+		double rt_span = (*rt_range.second)->peak->mY - m_grid_rt_min_;
+
+		// Sizes the bins to the median query, keeping at most one bin per peak.
+		nth_element(query_heights.begin(), query_heights.begin() + query_heights.size() / 2, query_heights.end());
+		m_grid_rt_width_ = max(query_heights[query_heights.size() / 2], rt_span / peaks.size());
+		if (!(m_grid_rt_width_ > 0))
+		{
+			m_grid_rt_width_ = 1;
+		}
+		size_t bins = (size_t)(rt_span / m_grid_rt_width_) + 1;
+
+		// Sorts the peaks on bin, then m/z, and marks where each bin starts.
+		auto bin = [&](const PeakToEventsRelation* peak)
+		{
+			return min((size_t)((peak->peak->mY - m_grid_rt_min_) / m_grid_rt_width_), bins - 1);
+		};
+		sort(peaks.begin(), peaks.end(), [&](PeakToEventsRelation* a, PeakToEventsRelation* b)
+		{
+			size_t bin_a = bin(a), bin_b = bin(b);
+			if (bin_a != bin_b)
+			{
+				return bin_a < bin_b;
+			}
+			if (a->peak->mX != b->peak->mX)
+			{
+				return a->peak->mX < b->peak->mX;
+			}
+			return a->peak->mID < b->peak->mID;
+		});
 
-		// Maps the first rt value occurance to its index in the rt ordered vector.
-		size_t size = m_rt_ordered_peaks_.size();
-		for (size_t index = 0; index < size; ++index)
+		m_grid_offsets_.assign(bins + 1, 0);
+		for (PeakToEventsRelation* peak : peaks)
+		{
+			++m_grid_offsets_[bin(peak) + 1];
+		}
+		for (size_t b = 1; b <= bins; ++b)
 		{
-			m_rt_map_.insert({ floor(m_rt_ordered_peaks_[index]->peak->mY), index });
+			m_grid_offsets_[b] += m_grid_offsets_[b - 1];
 		}
+		m_grid_peaks_ = std::move(peaks);
 	}
 
 	vector<Peak*> IsotopicClusterDetector::CalculateIsotopicClusterPeaks_(PeakToEventsRelation& base_peak, unsigned char chargestate,
-		DistributionTable& distribution_table)
+		const DistributionTable& distribution_table) const
 	{
 		// Detects base peak position within the isotopic distribution table.
 		int isotopic_shift = DetermineIsotopicDistributionShift_(base_peak, chargestate, distribution_table);
@@ -184,7 +236,7 @@ namespace TAPP::MassSpectrometry::Isotope
 		intensity_ordered_peaks.reserve(peak_list.size());
 		for (PeakToEventsRelation& peak : peak_list)
 		{
-			if (!peak.events.empty())
+			if (peak.peak != nullptr && !peak.events.empty())
 			{
 				intensity_ordered_peaks.push_back(&peak);
 			}
@@ -207,10 +259,13 @@ namespace TAPP::MassSpectrometry::Isotope
 			}
 		}
 
-		// Loops through the peaks and attempts to gather clusters for each.
-		vector<IsotopicCluster> clusters;
-		for (PeakToEventsRelation* peak : intensity_ordered_peaks)
+		// Gathers the clusters of each peak on its own, as they only read the grid. They're concatenated in order of intensity afterwards.
+		vector<vector<IsotopicCluster>> peak_clusters(intensity_ordered_peaks.size());
+		Utilities::ParallelFor(intensity_ordered_peaks.size(), m_thread_count_, [&](const size_t p)
 		{
+			PeakToEventsRelation* peak = intensity_ordered_peaks[p];
+			vector<IsotopicCluster>& clusters = peak_clusters[p];
+
 			// Sorts the events based on charge state.
 			sort(peak->events.begin(), peak->events.end(), [](const Event* a, const Event* b)
 			{
@@ -244,9 +299,7 @@ namespace TAPP::MassSpectrometry::Isotope
 					chargestate = event->precursor_charge_state;
 
 					// Acquires the isotopic distribution.
-					MIDAs midas(chargestate, 1, 1, 1e-150, m_midas_mode_);
-					midas.Initialize_Elemental_Composition(sequence, "", "H", "OH", 1);
-					DistributionTable isotopic_distribution(midas.Fine_Grained_Isotopic_Distribution());
+					const DistributionTable& isotopic_distribution(m_distributions_.Get(sequence, chargestate));
 
 					cluster.event_peak		= peak->peak;
 					cluster.chargestate		= chargestate;
@@ -255,6 +308,12 @@ namespace TAPP::MassSpectrometry::Isotope
 					clusters.push_back(cluster);
 				}
 			}
+		});
+
+		vector<IsotopicCluster> clusters;
+		for (vector<IsotopicCluster>& current_clusters : peak_clusters)
+		{
+			clusters.insert(clusters.end(), current_clusters.begin(), current_clusters.end());
 		}
 
 		return clusters;
@@ -278,7 +337,7 @@ namespace TAPP::MassSpectrometry::Isotope
 		filtered_peak_list.reserve(peak_list.size());
 		for (PeakToEventsRelation& peak : peak_list)
 		{
-			if (detected_peaks.find(peak.peak->mID) == detected_peaks.end())
+			if (peak.peak != nullptr && detected_peaks.find(peak.peak->mID) == detected_peaks.end())
 			{
 				filtered_peak_list.push_back(&peak);
 			}
@@ -291,7 +350,8 @@ namespace TAPP::MassSpectrometry::Isotope
 			return a->peak->mHeight > b->peak->mHeight;
 		});
 
-		// Loops through all the charge states, trying to determine which cluster configurations are viable.
+		// Loops through all the charge states, trying to determine which cluster configurations are viable. A peak's clusters
+		// depend on the clusters accepted before it, so they're only calculated for peaks that remain unclaimed, in order.
 		std::vector<IsotopicCluster>	clusters;
 		std::unordered_set<size_t>		clustered_peak_ids;
 		for (PeakToEventsRelation* peak : filtered_peak_list)
@@ -303,9 +363,7 @@ namespace TAPP::MassSpectrometry::Isotope
 				for (unsigned char chargestate = 1; chargestate <= m_max_chargestate_; ++chargestate)
 				{
 					// Acquires the isotopic distribution.
-					MIDAs midas(chargestate, 1, 1, 1e-150, m_midas_mode_);
-					midas.Initialize_Elemental_Composition(Averagine(m_averagine_table_, peak->peak->mX * chargestate), "", "H", "OH", 1);
-					DistributionTable isotopic_distribution(midas.Fine_Grained_Isotopic_Distribution());
+					const DistributionTable& isotopic_distribution(m_distributions_.GetAveragine(peak->peak->mX * chargestate, chargestate));
 
 					IsotopicCluster cluster(
 					{
@@ -327,9 +385,9 @@ namespace TAPP::MassSpectrometry::Isotope
 				// Adds the clustered peak ids to the set.
 				for (size_t cluster = clusters.size() - clusters_added; cluster < clusters.size(); ++cluster)
 				{
-					for (Peak* peak : clusters[cluster].clustered_peaks)
+					for (Peak* clustered_peak : clusters[cluster].clustered_peaks)
 					{
-						clustered_peak_ids.insert(peak->mID);
+						clustered_peak_ids.insert(clustered_peak->mID);
 					}
 				}
 			}
@@ -338,7 +396,7 @@ namespace TAPP::MassSpectrometry::Isotope
 		return clusters;
 	}
 
-	vector<PeakToEventsRelation*> IsotopicClusterDetector::GetPeaks_(double mz, double rt, double mz_sigma, double rt_sigma)
+	vector<PeakToEventsRelation*> IsotopicClusterDetector::GetPeaks_(double mz, double rt, double mz_sigma, double rt_sigma) const
 	{
 		// Calculates the region of interest.
 		double rt_min = rt - (rt_sigma * m_rt_sigma_range_);
@@ -349,39 +407,41 @@ namespace TAPP::MassSpectrometry::Isotope
 		// Creates the vector.
 		vector<PeakToEventsRelation*> peaks;
 
-		// Calculates the position of the minimum rt value peak.
-		size_t size = m_rt_ordered_peaks_.size();
-		size_t rt_index = 0;
-
-		auto floored_value = m_rt_map_.find(floor(rt_min));
-		if (floored_value != m_rt_map_.end())
+		// Calculates the RT bins overlapping the region.
+		size_t bins = m_grid_offsets_.size() - 1;
+		if (bins == 0 || rt_max < m_grid_rt_min_)
 		{
-			rt_index = floored_value->second;
+			return peaks;
 		}
-		else
+		size_t first_bin	= (size_t)max(0.0, floor((rt_min - m_grid_rt_min_) / m_grid_rt_width_));
+		size_t last_bin		= min((size_t)floor((rt_max - m_grid_rt_min_) / m_grid_rt_width_), bins - 1);
+
+		// Looks up the m/z range within each bin, in order to detect candidates for the selected region.
+		for (size_t bin = first_bin; bin <= last_bin; ++bin)
 		{
-			while (rt_index < size && m_rt_ordered_peaks_[rt_index]->peak->mY <= rt_min)
+			auto begin	= m_grid_peaks_.begin() + m_grid_offsets_[bin];
+			auto end	= m_grid_peaks_.begin() + m_grid_offsets_[bin + 1];
+			for (auto peak = lower_bound(begin, end, mz_min, [](PeakToEventsRelation* a, double value) { return a->peak->mX < value; });
+				peak != end && (*peak)->peak->mX <= mz_max; ++peak)
 			{
-				++rt_index;
+				if ((*peak)->peak->mY >= rt_min && (*peak)->peak->mY <= rt_max)
+				{
+					peaks.push_back(*peak);
+				}
 			}
 		}
 
-		// Loops through the remaining peaks, in order to detect candidates for the selected region.
-		while (rt_index < size && m_rt_ordered_peaks_[rt_index]->peak->mY <= rt_max)
+		// Orders the candidates on RT.
+		sort(peaks.begin(), peaks.end(), [](PeakToEventsRelation* a, PeakToEventsRelation* b)
 		{
-			double peak_mz = m_rt_ordered_peaks_[rt_index]->peak->mX;
-			if (peak_mz >= mz_min && peak_mz <= mz_max)
-			{
-				peaks.push_back(m_rt_ordered_peaks_[rt_index]);
-			}
-			++rt_index;
-		}
+			return a->peak->mY < b->peak->mY || (a->peak->mY == b->peak->mY && a->peak->mID < b->peak->mID);
+		});
 
 		return peaks;
 	}
 	
 	// Matches the isotopic distribution with the peaks within the cluster and returns the shift relative to the cluster.
-	int IsotopicClusterDetector::DetermineIsotopicDistributionShift_(PeakToEventsRelation& base_peak, unsigned char chargestate, DistributionTable& isotopic_distribution)
+	int IsotopicClusterDetector::DetermineIsotopicDistributionShift_(PeakToEventsRelation& base_peak, unsigned char chargestate, const DistributionTable& isotopic_distribution) const
 	{
 		// Attempts to locate peaks in the ascending direction.
 		vector<PeakToEventsRelation*> peaks(GetPeaks_(
@@ -428,7 +488,7 @@ namespace TAPP::MassSpectrometry::Isotope
 		return isotope_shift;
 	}
 
-	Peak* IsotopicClusterDetector::SelectIdealPeak_(const Peak* reference_peak, const vector<PeakToEventsRelation*> potential_peaks, const double expected_mz, const double expected_intensity)
+	Peak* IsotopicClusterDetector::SelectIdealPeak_(const Peak* reference_peak, const vector<PeakToEventsRelation*> potential_peaks, const double expected_mz, const double expected_intensity) const
 	{
 		// Loops through the available peaks, determining the best match.
 		Peak* best_match = nullptr;
@@ -14,6 +14,7 @@
 
 #ifdef LOAD_MIDAS
 #include "External/Midas/MIDAs.h"
+#include "MassSpectrometry/Isotope/DistributionCache.h"
 #endif
 
 using namespace TAPP::Filetypes::FileRelations;
@@ -35,29 +36,35 @@ namespace TAPP::MassSpectrometry::Isotope
 	class IsotopicClusterDetector
 	{
 		public:
-			IsotopicClusterDetector(double error_tolerance = 0.1, double mz_sigma_range = 1, double rt_sigma_range = 1, unsigned char max_chargestate = 0, unsigned char midas_mode = 1);
+			IsotopicClusterDetector(double error_tolerance = 0.1, double mz_sigma_range = 1, double rt_sigma_range = 1, unsigned char max_chargestate = 0, unsigned char midas_mode = 1, size_t thread_count = 1);
 
 			std::vector<IsotopicCluster> DetectClusters(std::vector<PeakToEventsRelation>& peak_list,
 			std::vector<TAPP::Filetypes::FileRelations::ScanToIdentificationsRelation>& scan_list, bool detect_structure = false);
 
 		private:
-			typedef std::vector<Isotopic_Distribution> DistributionTable; // std::vector<Isotopic_Distribution>
+			typedef DistributionCache::DistributionTable DistributionTable; // std::vector<Isotopic_Distribution>
 
 			double			m_error_tolerance_;
 			unsigned char	m_midas_mode_;
 			double			m_mz_sigma_range_;
 			double			m_rt_sigma_range_;
 			unsigned char	m_max_chargestate_;
+			size_t			m_thread_count_;
 
 			// Variables used during cluster calculation. These are cleaned after each cluster analysis.
 			std::vector<std::pair<char, double>>								m_averagine_table_; // Table is only created once per run for efficiency.
-			std::vector<TAPP::Filetypes::FileRelations::PeakToEventsRelation*>	m_rt_ordered_peaks_;
-			std::unordered_map<size_t, size_t>									m_rt_map_;
+			DistributionCache													m_distributions_; // Kept across runs, as the distributions don't depend on the peaks.
+
+			// The peaks placed in RT bins, the offsets pointing at the first peak of each bin. Peaks are sorted on m/z within a bin.
+			std::vector<TAPP::Filetypes::FileRelations::PeakToEventsRelation*>	m_grid_peaks_;
+			std::vector<size_t>													m_grid_offsets_;
+			double																m_grid_rt_min_;
+			double																m_grid_rt_width_;
 
 			std::vector<Peak*> CalculateIsotopicClusterPeaks_(TAPP::Filetypes::FileRelations::PeakToEventsRelation& base_peak, unsigned char chargestate,
-				DistributionTable& distribution_table);
+				const DistributionTable& distribution_table) const;
 
-			void CreateOrderedList_(std::vector<TAPP::Filetypes::FileRelations::PeakToEventsRelation>& peak_list);
+			void CreateGrid_(std::vector<TAPP::Filetypes::FileRelations::PeakToEventsRelation>& peak_list);
 
 			std::vector<IsotopicCluster> DetectEventBasedClusters_(std::vector<TAPP::Filetypes::FileRelations::PeakToEventsRelation>& peak_list,
 				std::vector<ScanToIdentificationsRelation>& scan_list);
@@ -65,11 +72,11 @@ namespace TAPP::MassSpectrometry::Isotope
 			std::vector<IsotopicCluster> DetectStructureBasedClusters_(std::vector<PeakToEventsRelation>& peak_list,
 				std::vector<IsotopicCluster>& detected_clusters);
 
-			int DetermineIsotopicDistributionShift_(PeakToEventsRelation& peak, unsigned char chargestate, DistributionTable& isotopic_distribution);
+			int DetermineIsotopicDistributionShift_(PeakToEventsRelation& peak, unsigned char chargestate, const DistributionTable& isotopic_distribution) const;
 
-			std::vector<PeakToEventsRelation*> GetPeaks_(double mz, double rt, double mz_sigma, double rt_sigma);
+			std::vector<PeakToEventsRelation*> GetPeaks_(double mz, double rt, double mz_sigma, double rt_sigma) const;
 			
-			Peak* SelectIdealPeak_(const Peak* reference_peak, const std::vector<PeakToEventsRelation*> potential_peaks, const double expected_mz, const double expected_intensity);
+			Peak* SelectIdealPeak_(const Peak* reference_peak, const std::vector<PeakToEventsRelation*> potential_peaks, const double expected_mz, const double expected_intensity) const;
 	};
 }
 
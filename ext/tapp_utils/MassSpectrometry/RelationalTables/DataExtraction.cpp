@@ -268,7 +268,10 @@ namespace TAPP::MassSpectrometry::RelationalTables
 				if (cluster->event)
 				{
 					scan_vector.push_back(cluster->event->spectral_scan);
-					scan_vector.push_back(cluster->event->precursor_scan);
+					if (cluster->event->precursor_scan)
+					{
+						scan_vector.push_back(cluster->event->precursor_scan);
+					}
 				}
 			}
 
@@ -283,11 +286,16 @@ namespace TAPP::MassSpectrometry::RelationalTables
 			size_t record_index = 0;
 			for (IsotopicCluster* cluster : input_vector)
 			{
-				if (cluster->event)
+				if (cluster->event && cluster->event->precursor_scan)
 				{
 					output_vector.push_back(records[record_index] + separator_string + records[record_index + 1]);
 					record_index += 2;
 				}
+				else if (cluster->event)
+				{
+					output_vector.push_back(records[record_index] + separator_string + invalid_string);
+					++record_index;
+				}
 				else
 				{
 					output_vector.push_back(invalid_string + separator_string + invalid_string);
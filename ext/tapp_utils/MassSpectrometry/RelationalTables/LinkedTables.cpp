@@ -27,7 +27,7 @@ namespace TAPP::MassSpectrometry::RelationalTables
 		// Initializes the tables.
 		/*** MZXML ***/
 
-		 m_event_table					= InitializeEventTable("events");
+		 m_event_table					= InitializeEventTable("events", invalid_char);
 		 m_scan_table					= InitializeScanTable("scans");
 
 		/*** MZID ***/
@@ -125,26 +125,26 @@ namespace TAPP::MassSpectrometry::RelationalTables
 	void LinkedTables::InsertIdentificationTables(const size_t file_id, const std::vector<IPL>& ipl_entries, const Mzid_File& mzid_file)
 	{
 		//used to hash string ids.
-		std::hash<std::string> hasher;
+		std::hash<std::string_view> hasher;
 
 		/*** FASTA SEQUENCES *************************************/
 
 		// Transfers the fasta sequences.
 		std::unordered_map<size_t, FastaSequence*> sequence_map;
 		sequence_map.reserve(mzid_file.sequences.size());
-		for (auto sequence : mzid_file.sequences)
+		for (const auto& sequence : mzid_file.sequences)
 		{
 			// Inserts the sequence into the table.
 			auto sequence_iterator = m_fasta_sequence_table.insert(
 			{
-				sequence.second.description,
-				sequence.second.id,
+				std::string(sequence.description),
+				std::string(sequence.id),
 				std::vector<PeptideEvidence*>(),
 				std::vector<ProteinHypothesis*>()
 			});
 
 			// Maps the new sequence.
-			sequence_map.insert({ hasher(sequence.second.id), &sequence_iterator.first->second });
+			sequence_map.insert({ hasher(sequence.id), &sequence_iterator.first->second });
 		}
 
 
@@ -154,11 +154,11 @@ namespace TAPP::MassSpectrometry::RelationalTables
 		// Transfers the peptides.
 		std::unordered_map<size_t, Peptide*> peptide_map;
 		peptide_map.reserve(mzid_file.peptides.size());
-		for (auto peptide : mzid_file.peptides)
+		for (const auto& peptide : mzid_file.peptides)
 		{
 			// Inserts the peptide_modifications
 			std::vector<PeptideModification*> peptide_modifications;
-			for (auto peptide_modification : peptide.second.modifications)
+			for (const auto& peptide_modification : peptide.modifications)
 			{
 				m_peptide_modification_table.insert(
 				{
@@ -166,8 +166,8 @@ namespace TAPP::MassSpectrometry::RelationalTables
 					peptide_modification.location,
 					peptide_modification.monoisotopicMassDelta,
 					peptide_modification.residues,
-					&m_cv_references_.insert({ hasher(*peptide_modification.cv_reference), *peptide_modification.cv_reference }).first->second,
-					&m_modification_names_.insert({hasher(*peptide_modification.name), *peptide_modification.name }).first->second,
+					&m_cv_references_.insert({ hasher(peptide_modification.cv_reference), std::string(peptide_modification.cv_reference) }).first->second,
+					&m_modification_names_.insert({hasher(peptide_modification.name), std::string(peptide_modification.name) }).first->second,
 					nullptr
 				});
 			}
@@ -175,8 +175,8 @@ namespace TAPP::MassSpectrometry::RelationalTables
 			// Inserts the peptide into the table.
 			auto peptide_iterator = m_peptide_table.insert(
 			{
-				peptide.second.id,
-				peptide.second.sequence,
+				std::string(peptide.id),
+				std::string(peptide.sequence),
 				peptide_modifications,
 				std::vector<IdentificationItem*>(),
 				std::vector<PeptideEvidence*>()
@@ -187,7 +187,7 @@ namespace TAPP::MassSpectrometry::RelationalTables
 				peptide_modification->peptide_relation = &peptide_iterator.first->second;
 			}
 
-			peptide_map.insert({hasher(peptide.second.id), &peptide_iterator.first->second});
+			peptide_map.insert({hasher(peptide.id), &peptide_iterator.first->second});
 		}
 
 
@@ -197,29 +197,29 @@ namespace TAPP::MassSpectrometry::RelationalTables
 		// Transfers the peptide evidence.
 		std::unordered_map<size_t, PeptideEvidence*> evidence_map;
 		evidence_map.reserve(mzid_file.peptide_evidence.size());
-		for (auto evidence : mzid_file.peptide_evidence)
+		for (const auto& evidence : mzid_file.peptide_evidence)
 		{
 			// Inserts the sequence into the table.
 			auto evidence_iterator = m_peptide_evidence_table.insert(
 			{
-				evidence.second.id,
-				evidence.second.start,
-				evidence.second.end,
-				evidence.second.pre,
-				evidence.second.post,
-				evidence.second.is_decoy,
-				peptide_map.find(hasher(evidence.second.peptide_reference->id))->second,
-				sequence_map.find(hasher(evidence.second.sequence_reference->id))->second,
+				std::string(evidence.id),
+				evidence.start,
+				evidence.end,
+				evidence.pre,
+				evidence.post,
+				evidence.is_decoy,
+				peptide_map.find(hasher(evidence.peptide_reference->id))->second,
+				sequence_map.find(hasher(evidence.sequence_reference->id))->second,
 				std::vector<IdentificationItem*>(),
 				std::vector<ProteinHypothesis*>()
 			});
 
 			// Creates the new relations.
-			peptide_map.find(hasher(evidence.second.peptide_reference->id))->second->peptide_evidence_relations.push_back(&evidence_iterator.first->second);
-			sequence_map.find(hasher(evidence.second.sequence_reference->id))->second->evidence_relations.push_back(&evidence_iterator.first->second);
+			peptide_map.find(hasher(evidence.peptide_reference->id))->second->peptide_evidence_relations.push_back(&evidence_iterator.first->second);
+			sequence_map.find(hasher(evidence.sequence_reference->id))->second->evidence_relations.push_back(&evidence_iterator.first->second);
 
 			// Maps the new sequence.
-			evidence_map.insert({ hasher(evidence.second.id), &evidence_iterator.first->second });
+			evidence_map.insert({ hasher(evidence.id), &evidence_iterator.first->second });
 		}
 
 
@@ -249,14 +249,14 @@ namespace TAPP::MassSpectrometry::RelationalTables
 		item_map.reserve(mzid_file.identification_items.size());
 		
 		// Loops through all the identification results.
-		for (auto result : mzid_file.identification_results)
+		for (const auto& result : mzid_file.identification_results)
 		{
 			// Creates a vector for the items.
 			std::vector<IdentificationItem*> item_vector;
-			item_vector.reserve(result.second.items.size());
+			item_vector.reserve(result.items.size());
 
 			// Loops through the items inside the current result.
-			for (auto item : result.second.items)
+			for (auto item : result.items)
 			{
 				// Loops through the CV_Params and creates a new vector.
 				std::vector<CV_Parameter> cv_parameters;
@@ -281,7 +281,7 @@ namespace TAPP::MassSpectrometry::RelationalTables
 					auto fragment_iterator = m_fragment_ion_table.insert(
 					{
 						fragment.indices,
-						fragment.name,
+						std::string(fragment.name),
 						fragment.charge,
 						fragment.mz_values,
 						fragment.intensity_values,
@@ -308,7 +308,7 @@ namespace TAPP::MassSpectrometry::RelationalTables
 				// Inserts the actual item.
 				auto item_iterator = m_identification_item_table.insert(
 				{
-					item->id,
+					std::string(item->id),
 					item->chargestate,
 					item->calculated_mz,
 					item->experimental_mz,
@@ -347,13 +347,15 @@ namespace TAPP::MassSpectrometry::RelationalTables
 
 			/*** IDENTIFICATION RESULTS ******************************/
 
-			Scan* scan_pointer(scan_map.find(result.second.scan_id)->second);
+			// The result is left without a scan if the scan information lacks it, such as one left out of a scan sidecar.
+			auto scan_iterator = scan_map.find(result.scan_id);
+			Scan* scan_pointer(scan_iterator == scan_map.end() ? nullptr : scan_iterator->second);
 
 			auto result_iterator = m_identification_result_table.insert(
 			{
-				result.second.id,
-				result.second.index,
-				result.second.retention_time,
+				std::string(result.id),
+				result.index,
+				result.retention_time,
 				scan_pointer,
 				item_vector,
 				std::vector<IsotopicCluster*>()
@@ -369,10 +371,13 @@ namespace TAPP::MassSpectrometry::RelationalTables
 			file_reference.identification_result_relations.push_back(&result_iterator.first->second);
 
 			// Creates a relationship towards the scan.
-			scan_pointer->identification_result_relation = &result_iterator.first->second;
+			if (scan_pointer)
+			{
+				scan_pointer->identification_result_relation = &result_iterator.first->second;
+			}
 
 			// Maps the new result.
-			result_map.insert({ hasher(result.second.id), &result_iterator.first->second });
+			result_map.insert({ hasher(result.id), &result_iterator.first->second });
 		}
 
 		// Creates an Isotopic Cluster Map
@@ -403,14 +408,14 @@ namespace TAPP::MassSpectrometry::RelationalTables
 		// Transfers the protein group and hypothesis.
 		std::unordered_map<size_t, ProteinGroup*> group_map;
 		group_map.reserve(mzid_file.protein_groups.size());
-		for (auto group : mzid_file.protein_groups)
+		for (const auto& group : mzid_file.protein_groups)
 		{
 			// Creates a vector for the all the hypotheses.
 			std::vector<ProteinHypothesis*> hypotheses_vector;
-			hypotheses_vector.reserve(group.second.hypotheses.size());
+			hypotheses_vector.reserve(group.hypotheses.size());
 
 			// Loops through all the hypothesis
-			for (auto hypothesis : group.second.hypotheses)
+			for (const auto& hypothesis : group.hypotheses)
 			{
 				// Creates a vector with the required items.
 				std::vector<IdentificationItem*> items;
@@ -423,7 +428,7 @@ namespace TAPP::MassSpectrometry::RelationalTables
 				// Creates the hypthesis struct and adds it to the table.
 				auto hypthesis_iterator = m_protein_hypothesis_table.insert(
 				{
-						hypothesis.id,
+						std::string(hypothesis.id),
 						hypothesis.passed_threshold,
 						evidence_map.find(hasher(hypothesis.evidence->id))->second,
 						sequence_map.find(hasher(hypothesis.sequence->id))->second,
@@ -442,8 +447,8 @@ namespace TAPP::MassSpectrometry::RelationalTables
 
 			// Creates the CV Parameter vector.
 			std::vector<CV_Parameter> cv_parameter_vector;
-			cv_parameter_vector.reserve(group.second.cv_parameters.size());
-			for (CV_Parameter& parameter : group.second.cv_parameters)
+			cv_parameter_vector.reserve(group.cv_parameters.size());
+			for (const CV_Parameter& parameter : group.cv_parameters)
 			{
 				cv_parameter_vector.push_back({ *m_cv_param_names_.find(parameter.first), parameter.second });
 			}
@@ -451,7 +456,7 @@ namespace TAPP::MassSpectrometry::RelationalTables
 			// Inserts the sequence into the table.
 			auto group_iterator = m_protein_group_table.insert(
 			{
-				group.second.id,
+				std::string(group.id),
 				cv_parameter_vector,
 				hypotheses_vector
 			});
@@ -463,7 +468,7 @@ namespace TAPP::MassSpectrometry::RelationalTables
 			}
 
 			// Maps the new protein group.
-			group_map.insert({ hasher(group.second.id), &group_iterator.first->second });
+			group_map.insert({ hasher(group.id), &group_iterator.first->second });
 		}
 	}
 
@@ -506,13 +511,13 @@ namespace TAPP::MassSpectrometry::RelationalTables
 		std::unordered_map<size_t, Event*> file_events;
 		for (const std::pair<size_t, TAPP::Filetypes::MzXML::Event>& event : mzxml_file.events)
 		{
-			size_t spec = event.second.spectral_scan->scan_id;
-			size_t pre = event.second.precursor_scan->scan_id;
+			// The precursor scan is absent when the mzXML file doesn't hold it.
+			Scan* precursor_scan = event.second.precursor_scan ? file_scans.find(event.second.precursor_scan->scan_id)->second : nullptr;
 
 			auto event_iterator = m_event_table.insert(
 			{
 				file_scans.find(event.second.spectral_scan->scan_id)->second,
-				file_scans.find(event.second.precursor_scan->scan_id)->second,
+				precursor_scan,
 				event.second.precursor_charge_state,
 				event.second.precursor_intensity,
 				event.second.precursor_mz
@@ -520,7 +525,10 @@ namespace TAPP::MassSpectrometry::RelationalTables
 
 			// Creates the relationship.
 			file_scans.find(event.second.spectral_scan->scan_id)->second->event_relations.push_back(&event_iterator.first->second);
-			file_scans.find(event.second.precursor_scan->scan_id)->second->event_relations.push_back(&event_iterator.first->second);
+			if (precursor_scan)
+			{
+				precursor_scan->event_relations.push_back(&event_iterator.first->second);
+			}
 
 			// Maps the new event.
 			file_events.insert({ event_iterator.first->second.spectral_scan->scan_id, &event_iterator.first->second });
@@ -11,10 +11,10 @@ namespace TAPP::MassSpectrometry::RelationalTables
 {
 	/*** MZXML ******************************************************************/
 
-	TAPP::Collections::Table<Event> InitializeEventTable(const std::string table_name)
+	TAPP::Collections::Table<Event> InitializeEventTable(const std::string table_name, const char invalid)
 	{
 		return TAPP::Collections::Table<Event>(table_name, { "event_spectral_scan", "event_precursor_scan", "event_precursor_chargestate", "event_precursor_intensity", "event_precursor_mz" },
-			[](std::vector<Event*>& events, const std::string& column_name)
+			[invalid](std::vector<Event*>& events, const std::string& column_name)
 		{
 			std::vector<std::string> records;
 			records.reserve(events.size());
@@ -28,9 +28,17 @@ namespace TAPP::MassSpectrometry::RelationalTables
 			}
 			else if (column_name == "event_precursor_scan")
 			{
+				std::string invalid_as_string(1, invalid);
 				for (Event* event : events)
 				{
-					records.push_back(std::to_string(event->precursor_scan->scan_id));
+					if (event->precursor_scan)
+					{
+						records.push_back(std::to_string(event->precursor_scan->scan_id));
+					}
+					else
+					{
+						records.push_back(invalid_as_string);
+					}
 				}
 			}
 			else if (column_name == "event_precursor_chargestate")
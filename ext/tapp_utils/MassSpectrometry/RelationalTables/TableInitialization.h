@@ -20,7 +20,7 @@ namespace TAPP::MassSpectrometry::RelationalTables
 {
 	/*** MZXML ***/
 
-	TAPP::Collections::Table<Event> InitializeEventTable(const std::string table_name);
+	TAPP::Collections::Table<Event> InitializeEventTable(const std::string table_name, const char invalid = '-');
 	TAPP::Collections::Table<Scan> InitializeScanTable(const std::string table_name);
 
 	/*** MZID ***/
@@ -6,6 +6,8 @@
 #ifndef INCLUDE_FSUTIL_H
 #define INCLUDE_FSUTIL_H
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 #ifdef WIN32
@@ -33,6 +35,13 @@
 #define ISUNIX
 #endif
 
+#ifdef ISUNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 class FSLittleEndian
 {
 public:
@@ -73,6 +82,34 @@ public:
 		return temp_pointer;
 	}
 
+	// Maps the first n elements of a file as an array.  The file is opened read only and the pages are private,
+	// so writes to the array stay in memory.  Returns nullptr if the file cannot be mapped, e.g. if it is shorter.
+	template <class T> static inline T* MapFile(const char* filename, const size_t n)
+	{
+		void* p = nullptr;
+#ifdef ISUNIX
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0)
+			return nullptr;
+		struct stat st;
+		if (n > 0 && fstat(fd, &st) == 0 && (size_t)st.st_size >= n * sizeof(T))
+		{
+			p = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED)
+				p = nullptr;
+		}
+		close(fd);
+#endif
+		return (T*)p;
+	}
+
+	template <class T> static inline void UnmapFile(T* p, const size_t n)
+	{
+#ifdef ISUNIX
+		munmap((void*)p, n * sizeof(T));
+#endif
+	}
+
     template <class T> static inline void CheckAlloc(T * &X, int N, char *s)
     {
 
@@ -97,6 +134,31 @@ public:
     }
 };
 
+// Deletes arrays that come either from ArrayAllocation or from MapFile, so both can be held by one unique_ptr
+template <class T> class ArrayDeleter
+{
+public:
+	T* mMapped;
+	size_t mMappedSize;
+
+	ArrayDeleter(T* mapped = nullptr, const size_t mapped_size = 0) : mMapped(mapped), mMappedSize(mapped_size)
+	{
+	}
+
+	void operator()(T* p)
+	{
+		if (p && p == mMapped)
+		{
+			FSUtil::UnmapFile(p, mMappedSize);
+			mMapped = nullptr;
+		}
+		else
+		{
+			delete[] p;
+		}
+	}
+};
+
 class Swap {
 public:
 
@@ -130,6 +192,19 @@ public:
         }
     }
 
+    // swaps n floats in place, written so that the compiler can vectorize it
+    inline static void MakeFloat32(float *x, const size_t n, int littleendian)
+    {
+        if (littleendian != FS_LITTLEENDIAN) {
+            for (size_t i = 0; i < n; i++) {
+                uint32_t w;
+                memcpy(&w, x + i, sizeof(w));
+                w = (w >> 24) | ((w >> 8) & 0xff00) | ((w << 8) & 0xff0000) | (w << 24);
+                memcpy(x + i, &w, sizeof(w));
+            }
+        }
+    }
+
     inline static void MakeInt64(unsigned LCMSInt64& x, bool littleendian)
     {
         if (littleendian != FS_LITTLEENDIAN) {
@@ -4,21 +4,37 @@
 
 #include <string.h>
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <unordered_set>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MESH_SSE2 1
+#endif
+
 #include "Mesh/Encoding.h"
 #include "Mesh/ConversionSpec.h"
 #include "DoubleMatrix.h"
 
+#include "Filetypes/MzXML/ScanIndex.h"
+#include "Filetypes/MzXML/ScanSidecar.h"
+#include "Filetypes/TAPP/LBL.h"
+#include "Filetypes/TAPP/PKB.h"
 #include "Filetypes/TAPP/PKS.h"
 
 #include "Filetypes/TAPP/TAPP_Output.h"
+#include "Utilities/Parallel.hpp"
+#include "Utilities/StringManipulation.h"
 
 #include "MiniPeak.h"
 
@@ -186,6 +202,10 @@ public:
     double mYFullCentroid;
     double mXPeak;
     double mYPeak;
+    double mXMin;  // bounding box of the peak region
+    double mXMax;
+    double mYMin;
+    double mYMax;
     int mI;
     int mJ;
     double mXSig;
@@ -216,6 +236,10 @@ public:
         mVolume = 0;
         mXPeak = 0;
         mYPeak = 0;
+        mXMin = 0;
+        mXMax = 0;
+        mYMin = 0;
+        mYMax = 0;
         mBorderBkgnd = 0;
         mNRefs = 0;
         mClass = 0;
@@ -229,6 +253,10 @@ public:
         mY = y;
         mI = i;
         mJ = j;
+        mXMin = 0;
+        mXMax = 0;
+        mYMin = 0;
+        mYMax = 0;
         mXSig = 0;
         mYSig = 0;
         mCount = 0;
@@ -271,16 +299,853 @@ inline bool SigSort(const Peak &p1, const Peak &p2) {
     return (p1.mHeight > p2.mHeight);
 }
 
-/*
-Accepts two peaks and returns which one is considered the largest.
+// the peaks as a structure of arrays.  the hot columns, the ones the matching
+// and warping loops read for every pair of peaks, are stored apart from the
+// rest, so scanning them touches 40 bytes a peak instead of a whole Peak
+class PeakTable {
+public:
+    // the fields of a Peak that aren't hot, one record per peak
+    struct Details {
+        int mID;
+        double mXFullCentroid;
+        double mYFullCentroid;
+        double mXPeak;
+        double mYPeak;
+        double mXMin;
+        double mXMax;
+        double mYMin;
+        double mYMax;
+        int mI;
+        int mJ;
+        double mVolume;
+        double mBorderBkgnd;
+        double mSNVolume;
+        double mSNHeight;
+        double mSNCentroid;
+        double mVCentroid;
+        int mCount;
+        int mNRefs;
+        int mClass;
+        int mFile;
+        MetaPeak *mMetaPeak;
+    };
+
+    // a read only view of the hot columns of a run of rows, for the
+    // algorithms that only need those.  any column pointer may be swapped for
+    // a scratch array, e.g. to look at the rows under a different time axis
+    struct Columns {
+        const double *mz;
+        const double *rt;
+        const double *height;
+        const double *mz_sigma;
+        const double *rt_sigma;
+        size_t size;
+    };
+
+    std::vector<double> mz;
+    std::vector<double> rt;
+    std::vector<double> height;
+    std::vector<double> mz_sigma;
+    std::vector<double> rt_sigma;
+    std::vector<Details> details;
 
-Used in combination with a paired index, which can be used to track
-the peak as it moves through various sortings and std::vectors.
-*/
-inline bool IndexedSigSort(const std::pair<int, Peak> &p1,
-                           const std::pair<int, Peak> &p2) {
-    return (p1.second.mHeight > p2.second.mHeight);
-}
+    PeakTable() {}
+
+    explicit PeakTable(const std::vector<Peak> &peaks) {
+        reserve(peaks.size());
+        for (const Peak &p : peaks) push_back(p);
+    }
+
+    size_t size() const { return mz.size(); }
+
+    bool empty() const { return mz.empty(); }
+
+    void reserve(size_t n) {
+        mz.reserve(n);
+        rt.reserve(n);
+        height.reserve(n);
+        mz_sigma.reserve(n);
+        rt_sigma.reserve(n);
+        details.reserve(n);
+    }
+
+    void clear() {
+        mz.clear();
+        rt.clear();
+        height.clear();
+        mz_sigma.clear();
+        rt_sigma.clear();
+        details.clear();
+    }
+
+    void push_back(const Peak &p) {
+        mz.push_back(p.mX);
+        rt.push_back(p.mY);
+        height.push_back(p.mHeight);
+        mz_sigma.push_back(p.mXSig);
+        rt_sigma.push_back(p.mYSig);
+        details.push_back({p.mID, p.mXFullCentroid, p.mYFullCentroid, p.mXPeak,
+                           p.mYPeak, p.mXMin, p.mXMax, p.mYMin, p.mYMax, p.mI,
+                           p.mJ, p.mVolume, p.mBorderBkgnd, p.mSNVolume,
+                           p.mSNHeight, p.mSNCentroid, p.mVCentroid, p.mCount,
+                           p.mNRefs, p.mClass, p.mFile, p.mMetaPeak});
+    }
+
+    // gathers row r back into a Peak
+    Peak Get(size_t r) const {
+        const Details &d = details[r];
+        Peak p;
+        p.mID = d.mID;
+        p.mX = mz[r];
+        p.mY = rt[r];
+        p.mXFullCentroid = d.mXFullCentroid;
+        p.mYFullCentroid = d.mYFullCentroid;
+        p.mXPeak = d.mXPeak;
+        p.mYPeak = d.mYPeak;
+        p.mXMin = d.mXMin;
+        p.mXMax = d.mXMax;
+        p.mYMin = d.mYMin;
+        p.mYMax = d.mYMax;
+        p.mI = d.mI;
+        p.mJ = d.mJ;
+        p.mXSig = mz_sigma[r];
+        p.mYSig = rt_sigma[r];
+        p.mHeight = height[r];
+        p.mVolume = d.mVolume;
+        p.mBorderBkgnd = d.mBorderBkgnd;
+        p.mSNVolume = d.mSNVolume;
+        p.mSNHeight = d.mSNHeight;
+        p.mSNCentroid = d.mSNCentroid;
+        p.mVCentroid = d.mVCentroid;
+        p.mCount = d.mCount;
+        p.mNRefs = d.mNRefs;
+        p.mClass = d.mClass;
+        p.mFile = d.mFile;
+        p.mMetaPeak = d.mMetaPeak;
+        return p;
+    }
+
+    std::vector<Peak> ToPeaks() const {
+        std::vector<Peak> peaks;
+        peaks.reserve(size());
+        for (size_t r = 0; r < size(); r++) peaks.push_back(Get(r));
+        return peaks;
+    }
+
+    // the rows [begin, end)
+    Columns View(size_t begin, size_t end) const {
+        return {mz.data() + begin,       rt.data() + begin,
+                height.data() + begin,   mz_sigma.data() + begin,
+                rt_sigma.data() + begin, end - begin};
+    }
+
+    Columns View() const { return View(0, size()); }
+
+    // a copy holding the rows in the given order
+    PeakTable Select(const std::vector<size_t> &rows) const {
+        PeakTable selected;
+        selected.reserve(rows.size());
+        for (size_t r : rows) {
+            selected.mz.push_back(mz[r]);
+            selected.rt.push_back(rt[r]);
+            selected.height.push_back(height[r]);
+            selected.mz_sigma.push_back(mz_sigma[r]);
+            selected.rt_sigma.push_back(rt_sigma[r]);
+            selected.details.push_back(details[r]);
+        }
+        return selected;
+    }
+};
+
+// a local maximum from the candidate scan, before it becomes a Peak
+class PeakCandidate {
+public:
+    double mHeight;
+    int mI;
+    int mJ;
+
+    // highest first, and equal heights in raster order
+    bool operator<(const PeakCandidate &c) const {
+        return (mHeight > c.mHeight) ||
+               ((mHeight == c.mHeight) &&
+                ((mJ < c.mJ) || ((mJ == c.mJ) && (mI < c.mI))));
+    }
+};
+
+// keeps the npeaks highest candidates added to it, in no more than twice
+// that space, so the result does not depend on the order they are added in
+class PeakSelector {
+public:
+    std::vector<PeakCandidate> mCandidates;
+    size_t mNPeaks;
+
+    explicit PeakSelector(const int npeaks) {
+        mNPeaks = npeaks > 0 ? npeaks : 0;
+    }
+
+    inline void Add(const int i, const int j, const double height) {
+        if (mCandidates.size() >= 2 * mNPeaks + 1) Trim();
+        mCandidates.push_back({height, i, j});
+    }
+
+    void Add(const PeakSelector &s) {
+        for (const PeakCandidate &c : s.mCandidates) Add(c.mI, c.mJ, c.mHeight);
+    }
+
+    // drop all but the npeaks highest
+    void Trim() {
+        if (mCandidates.size() > mNPeaks) {
+            std::nth_element(mCandidates.begin(),
+                             mCandidates.begin() + mNPeaks,
+                             mCandidates.end());
+            mCandidates.resize(mNPeaks);
+        }
+    }
+
+    // the npeaks highest, highest first
+    const std::vector<PeakCandidate> &Sorted() {
+        Trim();
+        std::sort(mCandidates.begin(), mCandidates.end());
+        return mCandidates;
+    }
+};
+
+// the local maxima of a mesh, highest first, and the peaks explored from the
+// first of them, kept in a .cnd file between centroid runs on the same mesh.
+// a peak's exploration stops below max(thresh * height, peakheightmin) and
+// depends on nothing else, so a later run reuses each explored peak whose
+// stop height comes out the same, see Mesh::FindPeaksCached
+class CandidateCache {
+public:
+    enum { VERSION = 1 };
+
+    // what the candidates were found in: the data file, the smoothing
+    // applied to it, and the mapping of indices to m/z and RT
+    struct Source {
+        int mNMZ = 0;
+        int mNRT = 0;
+        int mWarpedMesh = 0;
+        int mMassSpecType = 0;
+        double mMinMZ = 0;
+        double mDMZ = 0;
+        double mMinRT = 0;
+        double mDRT = 0;
+        double mSigmaMZ = 0;
+        double mMZAtSigma = 0;
+        int64_t mDatSize = 0;
+        int64_t mDatTime = 0;
+        std::vector<float> mKernel;
+
+        bool operator==(const Source &s) const {
+            return mNMZ == s.mNMZ && mNRT == s.mNRT &&
+                   mWarpedMesh == s.mWarpedMesh &&
+                   mMassSpecType == s.mMassSpecType && mMinMZ == s.mMinMZ &&
+                   mDMZ == s.mDMZ && mMinRT == s.mMinRT && mDRT == s.mDRT &&
+                   mSigmaMZ == s.mSigmaMZ && mMZAtSigma == s.mMZAtSigma &&
+                   mDatSize == s.mDatSize && mDatTime == s.mDatTime &&
+                   mKernel == s.mKernel;
+        }
+        bool operator!=(const Source &s) const { return !(*this == s); }
+    };
+
+    Source mSource;
+    std::vector<PeakCandidate> mCandidates;
+    // the stop height each of the first candidates was explored with, NaN
+    // if it was not, and the peak that came out
+    std::vector<double> mStops;
+    std::vector<Peak> mPeaks;
+
+    // as in MeshWindow::ExplorePeakSlope2
+    static double StopHeight(const double height, const double thresh,
+                             const double peakheightmin) {
+        double stop = thresh * height;
+        if (stop < peakheightmin) stop = peakheightmin;
+        return stop;
+    }
+
+    // make room for the first n candidates to be explored
+    void Reserve(const size_t n) {
+        if (mPeaks.size() >= n) return;
+        mStops.resize(n, std::numeric_limits<double>::quiet_NaN());
+        mPeaks.resize(n);
+    }
+
+    // the peaks are stored as they are in memory, so a cache is only read
+    // on the kind of platform that wrote it
+    // returns false if there is no such cache
+    bool Load(const char *filename) {
+        FILE *f = fopen(filename, "rb");
+        if (!f) return false;
+        bool ok = Read(f);
+        fclose(f);
+        if (!ok) {
+            mCandidates.clear();
+            mStops.clear();
+            mPeaks.clear();
+        }
+        return ok;
+    }
+
+    void Save(const char *filename) const {
+        FILE *f = fopen(filename, "wb");
+        if (!f) {
+            std::cerr << "Error - cannot write candidate cache " << filename
+                      << std::endl;
+            exit(-1);
+        }
+        uint32_t header[4] = {VERSION, FS_LITTLEENDIAN,
+                              (uint32_t)sizeof(PeakCandidate),
+                              (uint32_t)sizeof(Peak)};
+        bool ok = fwrite("TCND", 1, 4, f) == 4 &&
+                  fwrite(header, sizeof(uint32_t), 4, f) == 4 &&
+                  Fields(mSource, [f](const auto &x) {
+                      return fwrite(&x, sizeof(x), 1, f) == 1;
+                  }) &&
+                  Write(f, mSource.mKernel) && Write(f, mCandidates) &&
+                  Write(f, mStops) &&
+                  fwrite(mPeaks.data(), sizeof(Peak), mPeaks.size(), f) ==
+                      mPeaks.size();
+        if (fclose(f) != 0 || !ok) {
+            std::cerr << "Error - cannot write candidate cache " << filename
+                      << std::endl;
+            exit(-1);
+        }
+    }
+
+private:
+    static_assert(std::is_trivially_copyable<Peak>::value,
+                  "the cache stores Peaks as they are");
+
+    // apply op to each scalar of a source, in file order
+    template <class S, class Op>
+    static bool Fields(S &s, Op op) {
+        return op(s.mNMZ) && op(s.mNRT) && op(s.mWarpedMesh) &&
+               op(s.mMassSpecType) && op(s.mMinMZ) && op(s.mDMZ) &&
+               op(s.mMinRT) && op(s.mDRT) && op(s.mSigmaMZ) &&
+               op(s.mMZAtSigma) && op(s.mDatSize) && op(s.mDatTime);
+    }
+
+    // a vector is stored as its size and its elements
+    template <class T>
+    static bool Write(FILE *f, const std::vector<T> &data) {
+        uint64_t n = data.size();
+        return fwrite(&n, sizeof(n), 1, f) == 1 &&
+               fwrite(data.data(), sizeof(T), n, f) == n;
+    }
+
+    template <class T>
+    static bool Read(FILE *f, std::vector<T> &data) {
+        uint64_t n;
+        if (fread(&n, sizeof(n), 1, f) != 1) return false;
+        // guard against the size of a damaged cache
+        if (n > (uint64_t)std::numeric_limits<int>::max()) return false;
+        data.resize(n);
+        return fread(data.data(), sizeof(T), n, f) == n;
+    }
+
+    bool Read(FILE *f) {
+        char magic[4];
+        uint32_t header[4];
+        if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "TCND", 4) != 0 ||
+            fread(header, sizeof(uint32_t), 4, f) != 4 ||
+            header[0] != VERSION || header[1] != FS_LITTLEENDIAN ||
+            header[2] != sizeof(PeakCandidate) || header[3] != sizeof(Peak)) {
+            return false;
+        }
+        if (!Fields(mSource, [f](auto &x) {
+                return fread(&x, sizeof(x), 1, f) == 1;
+            }) ||
+            !Read(f, mSource.mKernel) || !Read(f, mCandidates) ||
+            !Read(f, mStops)) {
+            return false;
+        }
+        mPeaks.resize(mStops.size());
+        if (fread(mPeaks.data(), sizeof(Peak), mPeaks.size(), f) !=
+            mPeaks.size()) {
+            return false;
+        }
+        // the meta peaks belonged to the run that wrote the cache
+        for (Peak &p : mPeaks) p.mMetaPeak = nullptr;
+        return true;
+    }
+};
+
+// Separable smoothing of a mesh along m/z and RT with a kernel of window
+// points, as set by ConversionSmoothWindow and ConversionSmoothMethod.
+// The method is Gauss, with sigma a quarter of the window, or
+// SavitzkyGolay, a quadratic fit.  Cells beyond the mesh edges repeat the
+// edge.  A window of 1 or less leaves the mesh as it is.
+class MeshSmoother {
+public:
+    enum { BLOCKROWS = 32 };
+    std::vector<float> mKernel;
+    int mRadius;
+    int mThreads;
+
+    MeshSmoother() : mRadius(0), mThreads(1) {}
+
+    MeshSmoother(const int window, const std::string &method,
+                 const int nthreads = 1)
+        : mRadius(window > 1 ? window / 2 : 0), mThreads(nthreads) {
+        if (mRadius == 0) return;
+
+        const int R = mRadius;
+        std::vector<double> k(2 * R + 1);
+        if (method == "Gauss" || method == "Gaussian") {
+            double sigma = (2 * R + 1) / 4.0;
+            double sum = 0;
+            for (int i = -R; i <= R; i++) {
+                k[i + R] = exp(-0.5 * i * i / (sigma * sigma));
+                sum += k[i + R];
+            }
+            for (double &w : k) w /= sum;
+        } else if (method == "SavitzkyGolay" || method == "SG") {
+            double norm = (2.0 * R - 1) * (2.0 * R + 1) * (2.0 * R + 3);
+            for (int i = -R; i <= R; i++) {
+                k[i + R] = (3.0 * (3 * R * R + 3 * R - 1) - 15.0 * i * i) / norm;
+            }
+        } else {
+            std::cerr << "Error - unknown smoothing method " << method
+                      << ", use Gauss or SavitzkyGolay" << std::endl;
+            exit(-1);
+        }
+        mKernel.assign(k.begin(), k.end());
+    }
+
+    bool Active() const { return mRadius > 0; }
+
+    // smooth rows [row0, row1) of an nmz x nrt mesh into dst
+    // src holds the rows from src0 on, and must include the mRadius rows
+    // above and below, as far as the mesh goes
+    void SmoothRows(const float *src, const int src0, const int nmz,
+                    const int nrt, const int row0, const int row1,
+                    float *dst) const {
+        const int R = mRadius;
+        const int nblocks = (row1 - row0 + BLOCKROWS - 1) / BLOCKROWS;
+        TAPP::Utilities::ParallelFor(nblocks, mThreads, [&](const size_t b) {
+            std::vector<float> line(nmz);
+            const int j0 = row0 + (int)b * BLOCKROWS;
+            const int j1 = std::min(row1, j0 + BLOCKROWS);
+            for (int j = j0; j < j1; j++) {
+                // along RT
+                std::fill(line.begin(), line.end(), 0.0f);
+                for (int k = -R; k <= R; k++) {
+                    int jj = std::min(std::max(j + k, 0), nrt - 1);
+                    const float *s = src + (size_t)(jj - src0) * nmz;
+                    const float w = mKernel[k + R];
+                    for (int i = 0; i < nmz; i++) line[i] += w * s[i];
+                }
+
+                // along m/z, with the edges apart so the rest vectorizes
+                float *d = dst + (size_t)(j - row0) * nmz;
+                const int ilo = std::min(R, nmz);
+                const int ihi = std::max(ilo, nmz - R);
+                std::fill(d + ilo, d + ihi, 0.0f);
+                for (int k = -R; k <= R; k++) {
+                    const float *s = line.data() + k;
+                    const float w = mKernel[k + R];
+                    for (int i = ilo; i < ihi; i++) d[i] += w * s[i];
+                }
+                for (int i = 0; i < nmz; i++) {
+                    if (i == ilo) i = ihi;
+                    if (i >= nmz) break;
+                    float sum = 0;
+                    for (int k = -R; k <= R; k++) {
+                        int ii = std::min(std::max(i + k, 0), nmz - 1);
+                        sum += mKernel[k + R] * line[ii];
+                    }
+                    d[i] = sum;
+                }
+            }
+        });
+    }
+};
+
+// A rectangular window [mCol0, mCol1) x [mRow0, mRow1) of a mesh, with the
+// labels used while exploring peaks.  All i, j are full mesh indices.
+// Exploration still stops at the mesh edges, but a peak that needs a cell
+// outside the window sets mOverflow so that it can be redone on a larger one.
+class MeshWindow {
+public:
+    const float *v;  // value at (mCol0, mRow0)
+    int *hit;        // label at (mCol0, mRow0)
+    int mStride;
+    int mNMZ;
+    int mNRT;
+    int mCol0;
+    int mRow0;
+    int mCol1;
+    int mRow1;
+    bool mOverflow;
+    int mIMin;  // extent of the cells explored since ResetExtent
+    int mIMax;
+    int mJMin;
+    int mJMax;
+
+    // a cell on the path of ExplorePeakSlope2 or FindBoundary, and the next
+    // of its neighbours to visit
+    struct StackEntry {
+        int mI;
+        int mJ;
+        int mNext;
+        double mValue;
+    };
+    std::vector<StackEntry> mStack;
+
+    MeshWindow() {
+        set(nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0);
+    }
+
+    void set(const float *V, int *Hit, const int stride, const int nmz,
+             const int nrt, const int col0, const int row0, const int col1,
+             const int row1) {
+        v = V;
+        hit = Hit;
+        mStride = stride;
+        mNMZ = nmz;
+        mNRT = nrt;
+        mCol0 = col0;
+        mRow0 = row0;
+        mCol1 = col1;
+        mRow1 = row1;
+        mOverflow = false;
+    }
+
+    void ResetExtent(const int i, const int j) {
+        mIMin = mIMax = i;
+        mJMin = mJMax = j;
+    }
+
+    inline int Index(const int i, const int j) const {
+        return (j - mRow0) * mStride + (i - mCol0);
+    }
+
+    inline int UpLine() const { return -mStride; }
+
+    inline int DownLine() const { return +mStride; }
+
+    inline bool OnMeshEdge(const int i, const int j) const {
+        return i < 1 || i >= mNMZ - 1 || j < 1 || j >= mNRT - 1;
+    }
+
+    // flag the window when exploration leaves it
+    inline bool Outside(const int i, const int j) {
+        if (i < mCol0 || i >= mCol1 || j < mRow0 || j >= mRow1) {
+            mOverflow = true;
+            return true;
+        }
+        return false;
+    }
+
+    // just check if local max
+    // all eight neighbours must lie in the window
+    inline int IsPeak(const int i, const int j) const {
+        int p = Index(i, j);
+        double z = v[p];
+        if (z == 0) return 0;
+        if (v[p - 1] > z) return 0;
+        if (v[p + 1] > z) return 0;
+        if (v[p + UpLine()] > z) return 0;
+        if (v[p + DownLine()] > z) return 0;
+        if (v[p - 1 + UpLine()] > z) return 0;
+        if (v[p - 1 + DownLine()] > z) return 0;
+        if (v[p + 1 + UpLine()] > z) return 0;
+        if (v[p + 1 + DownLine()] > z) return 0;
+        return 1;
+    }
+
+    // append the columns of row j, from 1 to mNMZ - 2, for which IsPeak holds
+    void FindRowPeaks(const int j, std::vector<int> &columns) const {
+        FindRowPeaks(j, 1, mNMZ - 1, columns);
+    }
+
+    // same for the columns [i0, i1), which must lie within 1 to mNMZ - 2
+    // the window must span whole rows and rows j - 1 to j + 1
+    // compares four cells at a time with their eight neighbours where SSE2
+    // is available, and the rest one by one
+    void FindRowPeaks(const int j, const int i0, const int i1,
+                      std::vector<int> &columns) const {
+        int i = i0;
+        const int iend = i1;
+#ifdef MESH_SSE2
+        const float *c = v + Index(0, j);
+        const float *u = c + UpLine();
+        const float *d = c + DownLine();
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= iend; i += 4) {
+            __m128 z = _mm_loadu_ps(c + i);
+            __m128 higher = _mm_cmpgt_ps(_mm_loadu_ps(c + i - 1), z);
+            higher = _mm_or_ps(higher, _mm_cmpgt_ps(_mm_loadu_ps(c + i + 1), z));
+            higher = _mm_or_ps(higher, _mm_cmpgt_ps(_mm_loadu_ps(u + i), z));
+            higher = _mm_or_ps(higher, _mm_cmpgt_ps(_mm_loadu_ps(d + i), z));
+            higher = _mm_or_ps(higher, _mm_cmpgt_ps(_mm_loadu_ps(u + i - 1), z));
+            higher = _mm_or_ps(higher, _mm_cmpgt_ps(_mm_loadu_ps(d + i - 1), z));
+            higher = _mm_or_ps(higher, _mm_cmpgt_ps(_mm_loadu_ps(u + i + 1), z));
+            higher = _mm_or_ps(higher, _mm_cmpgt_ps(_mm_loadu_ps(d + i + 1), z));
+            // cmpneq is true for NaN, as z == 0 is false in IsPeak
+            int mask = _mm_movemask_ps(
+                _mm_andnot_ps(higher, _mm_cmpneq_ps(z, zero)));
+            if (mask) {
+                for (int k = 0; k < 4; k++) {
+                    if (mask & (1 << k)) columns.push_back(i + k);
+                }
+            }
+        }
+#endif
+        for (; i < iend; i++) {
+            if (IsPeak(i, j)) columns.push_back(i);
+        }
+    }
+
+    // Mark the cells reached from (i, j) by steps to one of the eight
+    // neighbours that never go up and stay at or above
+    // max(thresh * pheight, peakheightmin) with id, and add them up.  The
+    // cells are visited depth first, in the order the recursive version of
+    // this visited them, so the sums come out the same to the last bit; the
+    // path is kept in mStack rather than on the call stack, which wide flat
+    // peaks used to overflow.
+    void ExplorePeakSlope2(const int id, const int i, const int j,
+                           const double pheight, const double thresh,
+                           const double peakheightmin, const double prev,
+                           double &xsum, double &ysum, double &xsig,
+                           double &ysig, double &vsum, int &nhits) {
+        static const int di[8] = {-1, +1, 0, 0, -1, +1, -1, +1};
+        static const int dj[8] = {0, 0, +1, -1, -1, +1, +1, -1};
+
+        // here set threshold to MAXIMUM of fractional peak height and a min
+        // value
+        double bestthresh = thresh * pheight;
+        if (bestthresh < peakheightmin) bestthresh = peakheightmin;
+
+        // visit a cell from a neighbour of value from, or the start if from
+        // is negative, and return whether it is part of the peak
+        auto visit = [&](const int ci, const int cj, const double from,
+                         double &vv) {
+            // if at edge, leave
+            if (OnMeshEdge(ci, cj) || Outside(ci, cj)) return false;
+
+            // n the array offset of this pos
+            int n = Index(ci, cj);
+            // vv is the value there
+            vv = v[n];
+
+#if 1  // This is how it is written 5/26/09, and it allows overwrite of previous
+       // peaks. if not start, and goes up, then leave
+            if ((from >= 0) &&
+                ((hit[n] == id) || (from < vv) || (vv < bestthresh))) {
+                return false;
+            }
+#endif
+
+#if 0  //  This is different implementation that lets first peaks "win" the
+       //  territory
+            if ((from >= 0) && ((hit[n] != 0) || (from < vv) || (vv < bestthresh))) {
+                return false;
+            }
+#endif
+
+            // ok - this is part of the peak.  Mark it and continue
+            // exploration
+
+            double x = ci;  // xcoord(ci);
+            double y = cj;  // ycoord(cj);
+            xsum += x * vv;
+            ysum += y * vv;
+            xsig += x * x * vv;
+            ysig += y * y * vv;
+
+            vsum += vv;
+            nhits++;
+
+            hit[n] = id;  // mark with positive id
+            if (ci < mIMin) mIMin = ci;
+            if (ci > mIMax) mIMax = ci;
+            if (cj < mJMin) mJMin = cj;
+            if (cj > mJMax) mJMax = cj;
+            return true;
+        };
+
+        double vv;
+        if (!visit(i, j, prev, vv)) return;
+        mStack.clear();
+        mStack.push_back({i, j, 0, vv});
+        while (!mStack.empty()) {
+            StackEntry &top = mStack.back();
+            if (top.mNext == 8) {
+                mStack.pop_back();
+                continue;
+            }
+            const int d = top.mNext++;
+            const int ni = top.mI + di[d];
+            const int nj = top.mJ + dj[d];
+            // top is invalidated by the push
+            if (visit(ni, nj, top.mValue, vv)) {
+                mStack.push_back({ni, nj, 0, vv});
+            }
+        }
+    }
+
+    // Mark the cells of peak id connected to (i, j), and the cells bordering
+    // them, with -id, and add up the values of the border.  The cells are
+    // visited in the order of the recursive version of this, as in
+    // ExplorePeakSlope2.
+    void FindBoundary(const int id, const int i, const int j, double &bordersum,
+                      int &borderhits) {
+        static const int di[8] = {+1, +1, 0, -1, -1, -1, 0, +1};
+        static const int dj[8] = {0, -1, -1, -1, 0, +1, +1, +1};
+
+        // return whether the cell is part of the peak, and so has neighbours
+        // to visit
+        auto visit = [&](const int ci, const int cj) {
+            // if at edge, leave
+            if (OnMeshEdge(ci, cj) || Outside(ci, cj)) return false;
+
+            // n the array offset of this pos
+            int n = Index(ci, cj);
+
+            // if it's not the peak or boundary, mark it as boundary and leave
+            if (hit[n] != -id && hit[n] != id) {
+                hit[n] = -id;
+                bordersum += v[n];
+                borderhits++;
+                return false;
+            }
+
+            // if already marked as boundary, leave
+            if (hit[n] == -id) return false;
+
+            // it's part of the peak, mark it as boundary, but don't count it
+            // as boundary
+            hit[n] = -id;
+            return true;
+        };
+
+        if (!visit(i, j)) return;
+        mStack.clear();
+        mStack.push_back({i, j, 0, 0});
+        while (!mStack.empty()) {
+            StackEntry &top = mStack.back();
+            if (top.mNext == 8) {
+                mStack.pop_back();
+                continue;
+            }
+            const int d = top.mNext++;
+            const int ni = top.mI + di[d];
+            const int nj = top.mJ + dj[d];
+            if (visit(ni, nj)) mStack.push_back({ni, nj, 0, 0});
+        }
+    }
+
+    enum { RCENT = 1 };
+    enum { RWID = 4 * RCENT };
+    enum { KWID = 2 * RWID + 1 };
+
+    // weights of the windowed centroid around a peak, computed once
+    static const double *CentroidKernel() {
+        static const std::array<double, KWID * KWID> kernel = []() {
+            std::array<double, KWID * KWID> k;
+            double invrsq = 1.0 / (RCENT * RCENT);
+            for (int dj = -RWID; dj <= RWID; dj++) {
+                for (int di = -RWID; di <= RWID; di++) {
+                    k[(dj + RWID) * KWID + di + RWID] =
+                        exp(-0.5 * (di * di + dj * dj) * invrsq);
+                }
+            }
+            return k;
+        }();
+        return kernel.data();
+    }
+
+    // go +/- 4 around peak and find weighted centroid
+    // also find weighted s/n
+    // returns false, leaving p untouched, if the window is too small
+    bool FindWindowedCentroid(Peak &p) {
+        const double *kernel = CentroidKernel();
+        double wvsum = 0;
+        double wbksum = 0;
+        double wsum = 0;  // sum of w
+        double vsum = 0;
+        double xvsum = 0;
+        double yvsum = 0;
+        int imin = p.mI - RWID;
+        if (imin < 0) imin = 0;
+        int imax = p.mI + RWID + 1;
+        if (imax > mNMZ) imax = mNMZ;
+        int jmin = p.mJ - RWID;
+        if (jmin < 0) jmin = 0;
+        int jmax = p.mJ + RWID + 1;
+        if (jmax > mNRT) jmax = mNRT;
+        if (imin < mCol0 || imax > mCol1 || jmin < mRow0 || jmax > mRow1) {
+            mOverflow = true;
+            return false;
+        }
+
+        // the sums are taken in the same order as ever, so that the
+        // centroids do not change in the last digits
+        for (int j = jmin; j < jmax; j++) {
+            const float *pv = v + Index(imin, j);
+            const double *pw =
+                kernel + (j - p.mJ + RWID) * KWID + (imin - p.mI + RWID);
+            for (int i = imin; i < imax; i++, pv++, pw++) {
+                double w = *pw;
+                double vv = *pv;
+                double wv = vv * w;
+                xvsum += i * vv;
+                yvsum += j * vv;
+                vsum += vv;
+                wsum += w;    // sum of weights alone
+                wvsum += wv;  // sum of weights*v
+                wbksum += w * p.mBorderBkgnd;
+            }
+        }
+        p.mX = xvsum / vsum;
+        p.mY = yvsum / vsum;
+        p.mVCentroid = vsum;
+        p.mHeight = wvsum / wsum;
+        if (wvsum <= wbksum || wbksum == 0) {
+            p.mSNCentroid = 0.001;
+        } else {
+            p.mSNCentroid = (wvsum) / wbksum;
+        }
+        return true;
+    }
+};
+
+// a window of the mesh to centroid on its own, in m/z and RT
+struct MeshRegion {
+    int mID;
+    double mMZMin;
+    double mMZMax;
+    double mRTMin;
+    double mRTMax;
+};
+
+// a basin of Mesh::FindPeaksWatershed: the cells flooded from one maximum,
+// or from several of the same height joined by a plateau, and their sums
+struct MeshBasin {
+    int mParent;  // union-find link, the basin itself at the root
+    int mI;       // the maximum
+    int mJ;
+    double mHeight;
+    double mXSum;
+    double mYSum;
+    double mXSig;
+    double mYSig;
+    double mVSum;
+    int mCount;
+    int mIMin;
+    int mIMax;
+    int mJMin;
+    int mJMax;
+    double mSaddle;    // the highest cell the basin shares with another
+    int mSaddleBasin;  // and that basin, -1 if there is none
+};
+
+// the highest saddle between a peak and a neighbouring one
+struct PeakSaddle {
+    double mHeight;
+    int mPeak;  // numbered as in DumpPeaks, -1 if there is none
+};
 
 // #define DBGPK 1
 
@@ -296,13 +1161,19 @@ public:
     char datname[1024];
     char headername[1024];
     char indexname[1024];
+    char scanname[1024];
     FILE *file;  // this is mesh file whether read or write
     FILE *delta;
     double dsum;
     int nshiftedout;
     double y1outofcore;
-    std::unique_ptr<float[]> v;  // TODO: Adapt pointers to unique_ptr's
+    std::unique_ptr<float[], ArrayDeleter<float>> v;  // may be mapped from the .dat
     std::unique_ptr<int[]> hit;
+    // the cells of the mesh last loaded by loadFromFile, and an array of as
+    // many floats it left over, so that the next mesh of the same size
+    // reuses hit and that array instead of allocating them again
+    size_t loadedcells = 0;
+    std::unique_ptr<float[]> sparev;
     float *weight;
     unsigned short *count;  // does this put a limit on npeaks?
     double splatfactor;
@@ -313,6 +1184,10 @@ public:
     int donormalize;
     std::vector<Peak> peaks;
     std::vector<Peak *> indexed_peaks;
+    // the region id of each peak, see FindPeaksInRegions
+    std::vector<int> peak_regions;
+    // the highest saddle of each peak, see FindPeaksWatershed
+    std::vector<PeakSaddle> peak_saddles;
     Bound xbound;
     Bound ybound;
     double unitweight;
@@ -515,6 +1390,7 @@ public:
         sprintf(datname, "%s.dat", namestem);
         sprintf(headername, "%s.hdr", namestem);
         sprintf(indexname, "%s.inx", namestem);
+        sprintf(scanname, "%s.scn", namestem);
     }
 
     // mname refers to the input or output name of the MESH
@@ -546,6 +1422,7 @@ public:
         sprintf(meshname, "%s.mesh", namestem);
         sprintf(datname, "%s.dat", namestem);
         sprintf(headername, "%s.hdr", namestem);
+        sprintf(scanname, "%s.scn", namestem);
 
         strcpy(indexname, sourcename);
         n = strlen(indexname) - 1;
@@ -729,15 +1606,67 @@ public:
     // load regular mesh into mesh object
     // should allow both ascii and mesh data
     void loadFromFile(const char *Fname) {
-        if (strstr(Fname, ".hdr")) {
+        if (!loadHeaderFromFile(Fname)) {
+            return;
+        }
+
+        const size_t n = (size_t)mConversion.mNMZ * mConversion.mNRT;
+
+        if (n == loadedcells) {
+            KeepSpare();
+        } else {
+            hit.reset();
+            sparev.reset();
+        }
+        v.reset();
+        loadedcells = n;
+
+        if (!hit) {
+            hit.reset(FSUtil::ArrayAllocation<int>(
+                n, "allocating hit floats in mesh init"));
+        }
+        std::fill(hit.get(), hit.get() + n, 0);
+
+        // map the data when it is in host byte order, so that it is neither
+        // copied nor converted, and shares the page cache with other readers
+        float *mapped = nullptr;
+        if (mConversion.mMeshLittleEndian == FS_LITTLEENDIAN) {
+            mapped = FSUtil::MapFile<float>(datname, n);
+        }
+        if (mapped) {
+            v = decltype(v)(mapped, ArrayDeleter<float>(mapped, n));
             return;
         }
 
+        // otherwise read it in one go and swap it in place
+        v = decltype(v)(TakeSpare("allocating v floats in mesh init"));
+
+        FILE *f = fopen(datname, "rb");
+        if (!f) {
+            std::cerr << "Error - cannot open file " << datname << std::endl;
+            exit(-1);
+        }
+        size_t nread = fread(v.get(), sizeof(float), n, f);
+        fclose(f);
+
+        // grid may not write the last rows, which are left at zero
+        std::fill(v.get() + nread, v.get() + n, 0.0f);
+        Swap::MakeFloat32(v.get(), nread, mConversion.mMeshLittleEndian);
+    }
+
+    // set up names, conversion and bounds of a mesh without loading its data
+    // returns false if there is no mesh to load
+    bool loadHeaderFromFile(const char *Fname) {
+        if (strstr(Fname, ".hdr")) {
+            return false;
+        }
+
         FILE *f = fopen(Fname, "r");
         if (!f) {
             std::cout << "Error - cannot open file " << Fname << std::endl;
             exit(-1);
         }
+        fclose(f);
 
         strcpy(fname, Fname);
         strcpy(meshname, Fname);
@@ -750,28 +1679,6 @@ public:
 
         splatfactor = 1.0;
 
-        v.reset(
-            FSUtil::ArrayAllocation<float>(mConversion.mNMZ * mConversion.mNRT,
-                                           "allocating v floats in mesh init"));
-        hit.reset(
-            FSUtil::ArrayAllocation<int>(mConversion.mNMZ * mConversion.mNRT,
-                                         "allocating hit floats in mesh init"));
-
-        for (int i = 0; i < mConversion.mNMZ * mConversion.mNRT; i++) {
-            v[i] = 0;
-            hit[i] = 0;
-        }
-
-        f = fopen(datname, "rb");
-
-        for (int i = 0; i < mConversion.mNMZ * mConversion.mNRT; i++) {
-            float vv;
-            fread(&vv, sizeof(float), 1, f);
-            Swap::MakeFloat32(vv, mConversion.mMeshLittleEndian);
-            v[i] = vv;
-        }
-
-        fclose(f);
         xbound.SetMax(mConversion.mNMZ);
         ybound.SetMax(mConversion.mNRT);
 
@@ -780,14 +1687,88 @@ public:
         ty = 31.774;
         eps = 3.0;
 #endif
+        return true;
     }
 
-    // this is the expansion needed to rescale sigma from index space to world
-    // space
-    inline double ExpansionAtIndex(const double x) const {
-        double xorig = mConversion.IndexToWorldX(x);
-        double xorig2 = mConversion.IndexToWorldX(x + 1);  // check this
-        return fabs(xorig2 - xorig);
+    // read rows [row0, row1) of the mesh data file into dst
+    void readRows(FILE *f, const int row0, const int row1, float *dst) const {
+        size_t n = (size_t)(row1 - row0) * mConversion.mNMZ;
+        long long offset = (long long)row0 * mConversion.mNMZ * sizeof(float);
+#ifdef _WIN32
+        int err = _fseeki64(f, offset, SEEK_SET);
+#else
+        int err = fseeko(f, offset, SEEK_SET);
+#endif
+        if (err) {
+            std::cerr << "Error - cannot read rows " << row0 << " to " << row1
+                      << " of " << datname << std::endl;
+            exit(-1);
+        }
+        // as in loadFromFile, rows missing from the file are zero
+        size_t nread = fread(dst, sizeof(float), n, f);
+        std::fill(dst + nread, dst + n, 0.0f);
+        Swap::MakeFloat32(dst, nread, mConversion.mMeshLittleEndian);
+    }
+
+    // read rows [row0, row1) of the mesh data file into dst, smoothed if
+    // the smoother is active, with the rows it needs around them
+    void readRows(FILE *f, const int row0, const int row1, float *dst,
+                  const MeshSmoother &smoother) const {
+        if (!smoother.Active()) {
+            readRows(f, row0, row1, dst);
+            return;
+        }
+        int s0 = std::max(0, row0 - smoother.mRadius);
+        int s1 = std::min(mConversion.mNRT, row1 + smoother.mRadius);
+        std::vector<float> raw((size_t)(s1 - s0) * mConversion.mNMZ);
+        readRows(f, s0, s1, raw.data());
+        smoother.SmoothRows(raw.data(), s0, mConversion.mNMZ,
+                            mConversion.mNRT, row0, row1, dst);
+    }
+
+    // smooth the whole mesh in place, see MeshSmoother
+    void Smooth(const MeshSmoother &smoother) {
+        if (!smoother.Active()) return;
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        const bool loaded = (size_t)nmz * nrt == loadedcells;
+        float *smoothed = nullptr;
+        if (loaded) {
+            smoothed = TakeSpare("allocating smoothed floats in mesh");
+        } else {
+            smoothed = FSUtil::ArrayAllocation<float>(
+                (size_t)nmz * nrt, "allocating smoothed floats in mesh");
+        }
+        smoother.SmoothRows(v.get(), 0, nmz, nrt, 0, nrt, smoothed);
+        if (loaded) KeepSpare();
+        v = decltype(v)(smoothed);
+    }
+
+    // free the data and labels loaded by loadFromFile, with the spare array
+    void freeData() {
+        v.reset();
+        hit.reset();
+        sparev.reset();
+        loadedcells = 0;
+    }
+
+    // keep v as the spare array, unless it is mapped
+    void KeepSpare() {
+        if (v && v.get() != v.get_deleter().mMapped) sparev.reset(v.release());
+    }
+
+    // the spare array, or a new one, of loadedcells floats
+    float *TakeSpare(const char *what) {
+        if (sparev) return sparev.release();
+        return FSUtil::ArrayAllocation<float>(loadedcells, what);
+    }
+
+    // this is the expansion needed to rescale sigma from index space to world
+    // space
+    inline double ExpansionAtIndex(const double x) const {
+        double xorig = mConversion.IndexToWorldX(x);
+        double xorig2 = mConversion.IndexToWorldX(x + 1);  // check this
+        return fabs(xorig2 - xorig);
     }
 
     // this assumes the expansion factor is one at ConversionMassAtSigma
@@ -1046,6 +2027,45 @@ public:
         return mConversion.WorldToMeshX(wx + s) - mConversion.WorldToMeshX(wx);
     }
 
+    // read the numeric value of name="..." from the xml tag buff starts
+    // with, returns false if the tag lacks the attribute
+    static bool getXMLAttribute(const char *buff, const char *name,
+                                double &value) {
+        const char *end = strchr(buff, '>');
+        const char *p = strstr(buff, name);
+        if (!p || (end && p > end)) return false;
+        p = strchr(p, '"');
+        if (!p || (end && p > end)) return false;
+        value = strtod(p + 1, NULL);
+        return true;
+    }
+
+    // add the sidecar records of the scans loadXML skipped, reading only
+    // their headers through the scan index of the mzxml file.  without an
+    // index they are left out, rather than reading the whole file again
+    static void addSkippedScanRecords(
+        const char *xname,
+        std::vector<TAPP::Filetypes::MzXML::ScanSidecarRecord> &records) {
+        if (TAPP::Filetypes::MzXML::ReadScanIndex(xname).empty()) return;
+
+        std::unordered_set<uint32_t> recorded;
+        for (const auto &record : records) recorded.insert(record.scan_id);
+
+        TAPP::Filetypes::MzXML::MzXML_File headers =
+            TAPP::Filetypes::MzXML::ParseScanHeaders(xname);
+        for (const auto &scan : headers.scans) {
+            if (recorded.count(scan.first)) continue;
+            auto event = headers.events.find(scan.first);
+            records.push_back(TAPP::Filetypes::MzXML::CreateScanSidecarRecord(
+                scan.second,
+                event == headers.events.end() ? nullptr : &event->second));
+        }
+        std::sort(records.begin(), records.end(),
+                  [](const auto &a, const auto &b) {
+                      return a.scan_id < b.scan_id;
+                  });
+    }
+
     void loadXML(const char *xname, bool dump) {
 #ifdef DBG_GRID
         std::cerr << "In loadXML" << std::endl;
@@ -1097,6 +2117,9 @@ public:
         sprintf(ticname, "%s.tic", namestem);
         FILE *tic = fopen(ticname, "w");
 
+        // per-scan metadata written to the .scn sidecar for event linking
+        std::vector<TAPP::Filetypes::MzXML::ScanSidecarRecord> scanrecords;
+
 #ifdef DBG_GRID
         std::cerr << "Seeking <msRun" << std::endl;
 #endif
@@ -1125,13 +2148,18 @@ public:
             exit(-1);
         }
 
+        // the scans outside the rt range are skipped, their sidecar records
+        // are read from the scan index of the mzxml file afterwards
+        bool partial = false;
         IndexFile inx;
         inx.load(indexname);
         if (!inx.isEmpty()) {
             std::streampos offset =
                 inx.getOffset(mConversion.mMinRT * timeconversion);
-            if (offset >= 0) 
-				xml.seekg(offset);
+            if (offset >= 0) {
+                xml.seekg(offset);
+                partial = offset > 0;
+            }
         }
 
         int nscan = 0;
@@ -1210,6 +2238,9 @@ public:
                     exit(-1);
                 }
 
+                scanrecords.push_back(
+                    {(uint32_t)scannum, 0, 1, 0, strtod(p, NULL), 0, 0, 0});
+
                 nscan++;
                 rt /= timeconversion;
 
@@ -1224,6 +2255,7 @@ public:
                     std::cout << "high rt " << rt << " " << mConversion.mMaxRT
                               << " shifting remainder of mesh" << std::endl;
                     shiftMesh(1E6);
+                    partial = nscan < scancount;
 
                     break;
                 }
@@ -1333,9 +2365,45 @@ public:
                               << std::endl;
             } else {
                 nscan++;
+
+                // only the precursor information of ms/ms scans is kept, and
+                // only for the sidecar
+                TAPP::Filetypes::MzXML::ScanSidecarRecord record = {
+                    (uint32_t)scannum, 0, (uint8_t)mslevel, 0, 0, 0, 0, 0};
+                while (!strstr(buff, "retentionTime") &&
+                       !strstr(buff, "<peaks") && !xml.eof())
+                    xml.getline(buff, BUFFSIZE);
+                p = strstr(buff, "retentionTime");
+                if (p && (p = strstr(p, "PT")))
+                    record.retention_time = strtod(p + 2, NULL);
+                while (!strstr(buff, "<precursorMz") &&
+                       !strstr(buff, "<peaks") && !xml.eof())
+                    xml.getline(buff, BUFFSIZE);
+                p = strstr(buff, "<precursorMz");
+                if (p) {
+                    double value;
+                    if (getXMLAttribute(p, "precursorScanNum", value))
+                        record.precursor_scan_id = value;
+                    if (getXMLAttribute(p, "precursorCharge", value))
+                        record.precursor_charge_state = value;
+                    if (getXMLAttribute(p, "precursorIntensity", value))
+                        record.precursor_intensity = value;
+                    if (getXMLAttribute(p, "windowWideness", value))
+                        record.isolation_window = value;
+                    if ((p = strchr(p, '>')))
+                        record.precursor_mz = strtod(p + 1, NULL);
+                }
+                scanrecords.push_back(record);
             }
         }
 
+        if (partial) addSkippedScanRecords(xname, scanrecords);
+
+        TAPP::Filetypes::MzXML::WriteScanSidecar(
+            scanname,
+            TAPP::Utilities::StringManipulation::FilepathToFilename(xname),
+            scanrecords);
+
         fclose(tic);
         xml.close();
         if (dump && dumpfile) fclose(dumpfile);
@@ -1390,22 +2458,6 @@ public:
         vmean *= factor;
     }
 
-    // just check if local max
-    inline int IsPeak(const int i, const int j) {
-        int p = Index(i, j);
-        double z = v[p];
-        if (z == 0) return 0;
-        if (v[p - 1] > z) return 0;
-        if (v[p + 1] > z) return 0;
-        if (v[p + UpLine()] > z) return 0;
-        if (v[p + DownLine()] > z) return 0;
-        if (v[p - 1 + UpLine()] > z) return 0;
-        if (v[p - 1 + DownLine()] > z) return 0;
-        if (v[p + 1 + UpLine()] > z) return 0;
-        if (v[p + 1 + DownLine()] > z) return 0;
-        return 1;
-    }
-
     // This should return 1 if there are no downward paths from here
     // So, return 0 if there is a downward path available
     // A value near zero is assumed to be a local minimum
@@ -1520,331 +2572,994 @@ public:
                          nhits, bordersum, borderhits);
     }
 
-    void ExplorePeakSlope2(const int id, const int i, const int j,
-                           const double pheight, const double thresh,
-                           const double peakheightmin, const double prev,
-                           double &xsum, double &ysum, double &xsig,
-                           double &ysig, double &vsum, int &nhits) {
-        // if at edge, leave
-        if (i < 1 || i >= mConversion.mNMZ - 1 || j < 1 ||
-            j >= mConversion.mNRT - 1)
-            return;
+    // this converts index space to world space
+    void WarpPeakToMz(Peak *p) const {
+        p->mXSig = p->mXSig * WorldSigmaFromIndex(p->mX);
+        p->mX = mConversion.IndexToWorldX(p->mX);
+        p->mY = mConversion.IndexToWorldY(p->mY);
+        p->mXFullCentroid = mConversion.IndexToWorldX(p->mXFullCentroid);
+        p->mYFullCentroid = mConversion.IndexToWorldY(p->mYFullCentroid);
+        p->mXPeak = mConversion.IndexToWorldX(p->mXPeak);
+        p->mYPeak = mConversion.IndexToWorldY(p->mYPeak);
+        p->mXMin = mConversion.IndexToWorldX(p->mXMin);
+        p->mXMax = mConversion.IndexToWorldX(p->mXMax);
+        p->mYMin = mConversion.IndexToWorldY(p->mYMin);
+        p->mYMax = mConversion.IndexToWorldY(p->mYMax);
+    }
 
-        // n the array offset of this pos
-        int n = Index(i, j);
-        // vv is the value there
-        double vv = v[n];
+    // FindPeaks
+    // Calls IsPeak to find ALL local maxima
+    //   and adds each one to list
+    // Then goes through and calls ExplorePeakSlope
+    void FindPeaks(int npeaks, double thresh, double peakheightmin) {
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        MeshWindow window;
+        window.set(v.get(), hit.get(), nmz, nmz, nrt, 0, 0, nmz, nrt);
+
+        PeakSelector selector(npeaks);
+        std::vector<int> columns;
+        for (int y = 1; y < nrt - 1; y++) {
+            columns.clear();
+            window.FindRowPeaks(y, columns);
+            for (int x : columns) {
+                selector.Add(x, y, v[Index(x, y)]);
+            }
+        }
 
-#ifdef DBGPK
-        if ((fabs(xcoord(i) - tx)) < eps && fabs(ycoord(j) - ty) < eps)
-            qpk = true;
-#endif
+        SetPeaks(selector);
 
-        // here set threshold to MAXIMUM of fractional peak height and a min
-        // value
-        double bestthresh = thresh * pheight;
-        if (bestthresh < peakheightmin) bestthresh = peakheightmin;
+        int nallpeaks = peaks.size();
 
-#if 1  // This is how it is written 5/26/09, and it allows overwrite of previous
-       // peaks. if not start, and goes up, then leave
-        if ((prev >= 0) &&
-            ((hit[n] == id) || (prev < vv) || (vv < bestthresh))) {
-            return;
+        if (npeaks > nallpeaks) npeaks = nallpeaks;
+
+        // Now run through each peak and explore nbhrd
+        for (int i = 0; i < npeaks; i++) {
+            MeasurePeak(window, peaks[i], i, thresh, peakheightmin);
+        }
+
+        FinalizePeaks();
+    }
+
+    // Same as FindPeaks, but only finds the peaks at least peakheightmin
+    // high.  The mesh is first max-pooled into blocks of factor x factor
+    // cells, and only blocks that reach peakheightmin are scanned for local
+    // maxima at full resolution.  On sparse meshes this skips most cells.
+    // The peaks are those of FindPeaks whose maximum is at least
+    // peakheightmin.
+    void FindPeaksCoarse(int npeaks, double thresh, double peakheightmin,
+                         int factor) {
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        if (factor < 1) factor = 1;
+        const int ncols = (nmz + factor - 1) / factor;
+        const int nrows = (nrt + factor - 1) / factor;
+
+        // coarse level - the maximum of each block
+        std::vector<float> coarse((size_t)ncols * nrows,
+                                  -std::numeric_limits<float>::max());
+        for (int j = 0; j < nrt; j++) {
+            const float *row = v.get() + Index(0, j);
+            float *c = coarse.data() + (size_t)(j / factor) * ncols;
+            for (int b = 0; b < ncols; b++) {
+                const int i1 = std::min(nmz, (b + 1) * factor);
+                float m = c[b];
+                for (int i = b * factor; i < i1; i++) {
+                    m = std::max(m, row[i]);
+                }
+                c[b] = m;
+            }
         }
-#endif
 
-#if 0  //  This is different implementation that lets first peaks "win" the
-       //  territory
-        if ((prev >= 0) && ((hit[n] != 0) || (prev < vv) || (vv < bestthresh))) {
-			return;
+        MeshWindow window;
+        window.set(v.get(), hit.get(), nmz, nmz, nrt, 0, 0, nmz, nrt);
+
+        PeakSelector selector(npeaks);
+        std::vector<int> columns;
+        for (int bj = 0; bj < nrows; bj++) {
+            const int j0 = std::max(1, bj * factor);
+            const int j1 = std::min(nrt - 1, (bj + 1) * factor);
+            for (int bi = 0; bi < ncols; bi++) {
+                if (!(coarse[(size_t)bj * ncols + bi] >= peakheightmin)) {
+                    continue;
+                }
+                const int i0 = std::max(1, bi * factor);
+                const int i1 = std::min(nmz - 1, (bi + 1) * factor);
+                for (int y = j0; y < j1; y++) {
+                    columns.clear();
+                    window.FindRowPeaks(y, i0, i1, columns);
+                    for (int x : columns) {
+                        double h = v[Index(x, y)];
+                        if (h >= peakheightmin) selector.Add(x, y, h);
+                    }
+                }
+            }
         }
-#endif
 
-        // ok - this is part of the peak.  Mark it and continue exploration
+        SetPeaks(selector);
 
-        double x = i;  // xcoord(i);
-        double y = j;  // ycoord(j);
-        xsum += x * vv;
-        ysum += y * vv;
-        xsig += x * x * vv;
-        ysig += y * y * vv;
+        int nallpeaks = peaks.size();
 
-        vsum += vv;
-        nhits++;
+        if (npeaks > nallpeaks) npeaks = nallpeaks;
 
-#ifdef DBGPK
-        if (qpk)
-            std::cout << id << " 0 " << i << " " << j << " " << hit[n] << " "
-                      << x << " " << y << " " << vv << std::endl;
+        for (int i = 0; i < npeaks; i++) {
+            MeasurePeak(window, peaks[i], i, thresh, peakheightmin);
+        }
+
+        FinalizePeaks();
+    }
+
+    // Same as FindPeaks, but only holds a band of rows of the mesh in memory.
+    // The first pass streams the bands to collect the local maxima, the second
+    // pass streams them again, with halorows extra rows above and below, to
+    // explore each peak from the band that holds its maximum.  A peak that
+    // spreads beyond the halo is redone on a taller window around it, so the
+    // result is the same as FindPeaks.  hit is not filled in.
+    // An active smoother is applied to the rows as they are read, which
+    // gives the same mesh as Smooth.
+    void FindPeaksOutOfCore(int npeaks, double thresh, double peakheightmin,
+                            int bandrows, int halorows,
+                            const MeshSmoother &smoother = MeshSmoother()) {
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        if (bandrows < 1) bandrows = 1;
+        // the windowed centroid alone needs 4 rows either side
+        if (halorows < 4) halorows = 4;
+
+        FILE *f = fopen(datname, "rb");
+        if (!f) {
+            std::cerr << "Error - cannot open file " << datname << std::endl;
+            exit(-1);
+        }
 
-            // std::cout<< "id x y nhits " << id << " " << x << " " << y << " "
-            // << nhits << std::endl;
-#endif
+        size_t bandsize = (size_t)(bandrows + 2 * halorows) * nmz;
+        std::unique_ptr<float[]> bandv(FSUtil::ArrayAllocation<float>(
+            bandsize, "allocating band floats in mesh"));
+        std::unique_ptr<int[]> bandhit(FSUtil::ArrayAllocation<int>(
+            bandsize, "allocating band hits in mesh"));
+        MeshWindow window;
+        PeakSelector selector(npeaks);
+        std::vector<int> columns;
+
+        // pass 1 - local maxima
+        for (int b0 = 1; b0 < nrt - 1; b0 += bandrows) {
+            int b1 = std::min(b0 + bandrows, nrt - 1);
+            readRows(f, b0 - 1, b1 + 1, bandv.get(), smoother);
+            window.set(bandv.get(), nullptr, nmz, nmz, nrt, 0, b0 - 1, nmz,
+                       b1 + 1);
+            for (int y = b0; y < b1; y++) {
+                const float *row = bandv.get() + window.Index(0, y);
+                columns.clear();
+                window.FindRowPeaks(y, columns);
+                for (int x : columns) {
+                    selector.Add(x, y, row[x]);
+                }
+            }
+        }
 
-        hit[n] = id;  // mark with positive id
+        SetPeaks(selector);
 
-        ExplorePeakSlope2(id, i - 1, j, pheight, thresh, peakheightmin, vv,
-                          xsum, ysum, xsig, ysig, vsum, nhits);
-        ExplorePeakSlope2(id, i + 1, j, pheight, thresh, peakheightmin, vv,
-                          xsum, ysum, xsig, ysig, vsum, nhits);
-        ExplorePeakSlope2(id, i, j + 1, pheight, thresh, peakheightmin, vv,
-                          xsum, ysum, xsig, ysig, vsum, nhits);
-        ExplorePeakSlope2(id, i, j - 1, pheight, thresh, peakheightmin, vv,
-                          xsum, ysum, xsig, ysig, vsum, nhits);
-
-        ExplorePeakSlope2(id, i - 1, j - 1, pheight, thresh, peakheightmin, vv,
-                          xsum, ysum, xsig, ysig, vsum, nhits);
-        ExplorePeakSlope2(id, i + 1, j + 1, pheight, thresh, peakheightmin, vv,
-                          xsum, ysum, xsig, ysig, vsum, nhits);
-        ExplorePeakSlope2(id, i - 1, j + 1, pheight, thresh, peakheightmin, vv,
-                          xsum, ysum, xsig, ysig, vsum, nhits);
-        ExplorePeakSlope2(id, i + 1, j - 1, pheight, thresh, peakheightmin, vv,
-                          xsum, ysum, xsig, ysig, vsum, nhits);
-    }
+        int nallpeaks = peaks.size();
 
-    void FindBoundary(const int id, const int i, const int j, double &bordersum,
-                      int &borderhits) {
-        // if at edge, leave
-        if (i < 1 || i >= mConversion.mNMZ - 1 || j < 1 ||
-            j >= mConversion.mNRT - 1)
-            return;
+        if (npeaks > nallpeaks) npeaks = nallpeaks;
 
-        // n the array offset of this pos
-        int n = Index(i, j);
+        // pass 2 - explore each peak from the band holding its maximum
+        std::vector<std::vector<int>> banded((nrt + bandrows - 1) / bandrows);
+        for (int i = 0; i < npeaks; i++) {
+            banded[peaks[i].mJ / bandrows].push_back(i);
+        }
+
+        std::vector<int> deferred;
+        for (size_t b = 0; b < banded.size(); b++) {
+            if (banded[b].empty()) continue;
+            int r0 = std::max(0, (int)b * bandrows - halorows);
+            int r1 = std::min(nrt, ((int)b + 1) * bandrows + halorows);
+            readRows(f, r0, r1, bandv.get(), smoother);
+            std::fill(bandhit.get(), bandhit.get() + (size_t)(r1 - r0) * nmz,
+                      0);
+            window.set(bandv.get(), bandhit.get(), nmz, nmz, nrt, 0, r0, nmz,
+                       r1);
+            for (int i : banded[b]) {
+                if (!MeasurePeak(window, peaks[i], i, thresh, peakheightmin)) {
+                    deferred.push_back(i);
+                }
+            }
+        }
 
-        // bool qpk = false;
-#ifdef DBGPK
-        if ((fabs(xcoord(i) - tx)) < eps && fabs(ycoord(j) - ty) < eps)
-            qpk = true;
-#endif
+        // peaks too large for the halo get a window of their own, doubled
+        // until it holds them
+        for (int i : deferred) {
+            Peak &p = peaks[i];
+            for (int h = 2 * halorows;; h *= 2) {
+                int r0 = std::max(0, p.mJ - h);
+                int r1 = std::min(nrt, p.mJ + h + 1);
+                std::vector<float> peakv((size_t)(r1 - r0) * nmz);
+                std::vector<int> peakhit((size_t)(r1 - r0) * nmz, 0);
+                readRows(f, r0, r1, peakv.data(), smoother);
+                window.set(peakv.data(), peakhit.data(), nmz, nmz, nrt, 0, r0,
+                           nmz, r1);
+                if (MeasurePeak(window, p, i, thresh, peakheightmin)) break;
+            }
+        }
 
-        // if it's not the peak or boundary, mark it as boundary and leave
-        if (hit[n] != -id && hit[n] != id) {
-            // vv is the value there
-            double vv = v[n];
-            hit[n] = -id;
-            bordersum += vv;
-            borderhits++;
+        fclose(f);
 
-#ifdef DBGPK
-            if (qpk)
-                std::cout << id << " 1 " << i << " " << j << " " << hit[n]
-                          << " " << xcoord(i) << " " << ycoord(j) << " " << vv
-                          << std::endl;
-#endif
-            return;
+        FinalizePeaks();
+    }
+
+    // Same as FindPeaks, but only inside the given regions, and only reads
+    // the cells of each region and a margin of halorows around it from the
+    // .dat, through a mapping when the data is in host byte order and seeks
+    // otherwise.  Each region is searched on its own for its npeaks highest
+    // maxima, so a peak in two regions is found twice.  peak_regions holds
+    // the region id of each peak.  Peaks too large for the margin are redone
+    // with a margin of their own, as in FindPeaksOutOfCore.
+    void FindPeaksInRegions(const std::vector<MeshRegion> &regions,
+                            int npeaks, double thresh, double peakheightmin,
+                            int halorows,
+                            const MeshSmoother &smoother = MeshSmoother()) {
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        // the windowed centroid alone needs 4 cells either side
+        if (halorows < 4) halorows = 4;
+
+        FILE *f = fopen(datname, "rb");
+        if (!f) {
+            std::cerr << "Error - cannot open file " << datname << std::endl;
+            exit(-1);
+        }
+        const size_t n = (size_t)nmz * nrt;
+        float *mapping = nullptr;
+        if (mConversion.mMeshLittleEndian == FS_LITTLEENDIAN &&
+            !smoother.Active()) {
+            mapping = FSUtil::MapFile<float>(datname, n);
         }
+        std::unique_ptr<float[], ArrayDeleter<float>> mapped(
+            mapping, ArrayDeleter<float>(mapping, n));
 
-        // if already marked as boundary, leave
-        if (hit[n] == -id) return;
+        peaks.clear();
+        std::vector<int> regionof;
+        std::vector<float> boxv;
+        std::vector<int> boxhit;
+        std::vector<int> columns;
+        MeshWindow window;
+
+        for (const MeshRegion &region : regions) {
+            // the cells whose maxima belong to the region, inclusive
+            int i0 = std::max(
+                1, (int)floor(mConversion.WorldToIndexX(region.mMZMin)));
+            int i1 = std::min(
+                nmz - 2, (int)ceil(mConversion.WorldToIndexX(region.mMZMax)));
+            int j0 = std::max(
+                1, (int)floor(mConversion.WorldToIndexY(region.mRTMin)));
+            int j1 = std::min(
+                nrt - 2, (int)ceil(mConversion.WorldToIndexY(region.mRTMax)));
+            if (i0 > i1 || j0 > j1) {
+                std::cerr << "Region " << region.mID
+                          << " lies outside the mesh, skipping it"
+                          << std::endl;
+                continue;
+            }
 
-        // if it's part of the peak, mark it as boundary, but don't count it as
-        // boundary
-        if (hit[n] == id) {
-            hit[n] = -id;
+            int c0 = std::max(0, i0 - halorows);
+            int c1 = std::min(nmz, i1 + halorows + 1);
+            int r0 = std::max(0, j0 - halorows);
+            int r1 = std::min(nrt, j1 + halorows + 1);
+            readBox(f, mapped.get(), r0, r1, c0, c1, boxv, smoother);
+            boxhit.assign(boxv.size(), 0);
+            window.set(boxv.data(), boxhit.data(), c1 - c0, nmz, nrt, c0, r0,
+                       c1, r1);
+
+            PeakSelector selector(npeaks);
+            for (int y = j0; y <= j1; y++) {
+                const float *row = boxv.data() + window.Index(0, y);
+                columns.clear();
+                window.FindRowPeaks(y, i0, i1 + 1, columns);
+                for (int x : columns) {
+                    selector.Add(x, y, row[x]);
+                }
+            }
+
+            std::vector<int> deferred;
+            for (const PeakCandidate &c : selector.Sorted()) {
+                int i = peaks.size();
+                peaks.push_back(Peak(c.mI, c.mJ, c.mHeight));
+                regionof.push_back(region.mID);
+                if (!MeasurePeak(window, peaks[i], i, thresh, peakheightmin)) {
+                    deferred.push_back(i);
+                }
+            }
+
+            for (int i : deferred) {
+                Peak &p = peaks[i];
+                for (int h = 2 * halorows;; h *= 2) {
+                    int pc0 = std::max(0, p.mI - h);
+                    int pc1 = std::min(nmz, p.mI + h + 1);
+                    int pr0 = std::max(0, p.mJ - h);
+                    int pr1 = std::min(nrt, p.mJ + h + 1);
+                    std::vector<float> peakv;
+                    readBox(f, mapped.get(), pr0, pr1, pc0, pc1, peakv,
+                            smoother);
+                    std::vector<int> peakhit(peakv.size(), 0);
+                    window.set(peakv.data(), peakhit.data(), pc1 - pc0, nmz,
+                               nrt, pc0, pr0, pc1, pr1);
+                    if (MeasurePeak(window, p, i, thresh, peakheightmin))
+                        break;
+                }
+            }
         }
 
-        FindBoundary(id, i + 1, j, bordersum, borderhits);
-        FindBoundary(id, i + 1, j - 1, bordersum, borderhits);
-        FindBoundary(id, i, j - 1, bordersum, borderhits);
-        FindBoundary(id, i - 1, j - 1, bordersum, borderhits);
-        FindBoundary(id, i - 1, j, bordersum, borderhits);
-        FindBoundary(id, i - 1, j + 1, bordersum, borderhits);
-        FindBoundary(id, i, j + 1, bordersum, borderhits);
-        FindBoundary(id, i + 1, j + 1, bordersum, borderhits);
-    }
+        fclose(f);
 
-    // this converts index space to world space
-    void WarpPeakToMz(Peak *p) const {
-        p->mXSig = p->mXSig * WorldSigmaFromIndex(p->mX);
-        p->mX = mConversion.IndexToWorldX(p->mX);
-        p->mY = mConversion.IndexToWorldY(p->mY);
-        p->mXFullCentroid = mConversion.IndexToWorldX(p->mXFullCentroid);
-        p->mYFullCentroid = mConversion.IndexToWorldY(p->mYFullCentroid);
-        p->mXPeak = mConversion.IndexToWorldX(p->mXPeak);
-        p->mYPeak = mConversion.IndexToWorldY(p->mYPeak);
+        FinalizePeaks();
+
+        peak_regions.assign(peaks.size(), 0);
+        for (size_t i = 0; i < indexed_peaks.size(); i++) {
+            if (indexed_peaks[i]) {
+                peak_regions[indexed_peaks[i] - peaks.data()] = regionof[i];
+            }
+        }
     }
 
-    // FindPeaks
-    // Calls IsPeak to find ALL local maxima
-    //   and adds each one to list
-    // Then goes through and calls ExplorePeakSlope
-    void FindPeaks(int npeaks, double thresh, double peakheightmin) {
-        for (int y = 1; y < mConversion.mNRT - 1; y++) {
-            for (int x = 1; x < mConversion.mNMZ - 1; x++) {
-                if (IsPeak(x, y)) {
-                    AddPeak(x, y, npeaks);
+    // read the cells [col0, col1) of rows [row0, row1) of the mesh data into
+    // dst, row after row.  takes them from the mapped data when there is
+    // some, and otherwise seeks to each row of the file
+    void readBox(FILE *f, const float *mapped, const int row0, const int row1,
+                 const int col0, const int col1, std::vector<float> &dst,
+                 const MeshSmoother &smoother) const {
+        const int nmz = mConversion.mNMZ;
+        const size_t width = col1 - col0;
+        dst.resize((size_t)(row1 - row0) * width);
+        if (mapped) {
+            for (int j = row0; j < row1; j++) {
+                const float *row = mapped + (size_t)j * nmz + col0;
+                std::copy(row, row + width, &dst[(j - row0) * width]);
+            }
+            return;
+        }
+        // the smoother needs whole rows
+        if (smoother.Active()) {
+            std::vector<float> rows((size_t)(row1 - row0) * nmz);
+            readRows(f, row0, row1, rows.data(), smoother);
+            for (int j = row0; j < row1; j++) {
+                const float *row = rows.data() + (size_t)(j - row0) * nmz + col0;
+                std::copy(row, row + width, &dst[(j - row0) * width]);
+            }
+            return;
+        }
+        for (int j = row0; j < row1; j++) {
+            float *cells = &dst[(j - row0) * width];
+            long long offset =
+                ((long long)j * nmz + col0) * (long long)sizeof(float);
+#ifdef _WIN32
+            int err = _fseeki64(f, offset, SEEK_SET);
+#else
+            int err = fseeko(f, offset, SEEK_SET);
+#endif
+            if (err) {
+                std::cerr << "Error - cannot read row " << j << " of "
+                          << datname << std::endl;
+                exit(-1);
+            }
+            // as in loadFromFile, cells missing from the file are zero
+            size_t nread = fread(cells, sizeof(float), width, f);
+            std::fill(cells + nread, cells + width, 0.0f);
+            Swap::MakeFloat32(cells, nread, mConversion.mMeshLittleEndian);
+        }
+    }
+
+    // Same as FindPeaks, but the mesh is cut into tiles of tilerows rows that
+    // are handled on nthreads threads (0 for one per hardware thread).  Each
+    // tile explores the peaks whose maximum it holds, with halorows extra
+    // rows above and below and labels of its own, and the labels are then
+    // merged into hit.  A peak that spreads beyond the halo is redone on a
+    // taller window around it.  The peaks and hit are the same as FindPeaks
+    // for any number of threads.
+    void FindPeaksParallel(int npeaks, double thresh, double peakheightmin,
+                           int nthreads, int tilerows, int halorows) {
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        if (tilerows < 1) tilerows = 1;
+        // the windowed centroid alone needs 4 rows either side
+        if (halorows < 4) halorows = 4;
+        const int ntiles = (nrt + tilerows - 1) / tilerows;
+
+        // highest local maxima of each tile
+        std::vector<PeakSelector> maxima(ntiles, PeakSelector(npeaks));
+        TAPP::Utilities::ParallelFor(ntiles, nthreads, [&](const size_t t) {
+            MeshWindow window;
+            window.set(v.get(), nullptr, nmz, nmz, nrt, 0, 0, nmz, nrt);
+            int y0 = std::max(1, (int)t * tilerows);
+            int y1 = std::min(nrt - 1, ((int)t + 1) * tilerows);
+            std::vector<int> columns;
+            for (int y = y0; y < y1; y++) {
+                columns.clear();
+                window.FindRowPeaks(y, columns);
+                for (int x : columns) {
+                    maxima[t].Add(x, y, v[Index(x, y)]);
                 }
             }
+        });
+        PeakSelector selector(npeaks);
+        for (const PeakSelector &tile : maxima) {
+            selector.Add(tile);
         }
 
-        // this sorts based on peak value, but don't know bkgnd yet
-        sort(peaks.begin(), peaks.end());
+        SetPeaks(selector);
 
         int nallpeaks = peaks.size();
 
         if (npeaks > nallpeaks) npeaks = nallpeaks;
 
-        // Now run through each peak and explore nbhrd
+        std::vector<std::vector<int>> tiled(ntiles);
         for (int i = 0; i < npeaks; i++) {
-            Peak *p = &peaks[i];
-            p->mID = i;
-            p->mCount = 1;
-            double x = p->mI;  // xcoord(p->mI);
-            double y = p->mJ;  // ycoord(p->mJ);
-            p->mXPeak = x;
-            p->mYPeak = y;
-            p->mXFullCentroid = p->mHeight * x;
-            p->mYFullCentroid = p->mHeight * y;
-            p->mXSig = p->mHeight * x * x;
-            p->mYSig = p->mHeight * y * y;
-            p->mVolume = p->mHeight;
-            double bordersum = 0;
-            int borderhits = 0;
-            ExplorePeakSlope2(i + 1, p->mI, p->mJ, p->mHeight, thresh,
-                              peakheightmin, -1, p->mXFullCentroid,
-                              p->mYFullCentroid, p->mXSig, p->mYSig, p->mVolume,
-                              p->mCount);
-            FindBoundary(i + 1, p->mI, p->mJ, bordersum, borderhits);
-            if (borderhits < 1) borderhits = 1;
-            p->mBorderBkgnd = bordersum / borderhits;
-            // this is full centroid
-            p->mXFullCentroid /= p->mVolume;
-            p->mYFullCentroid /= p->mVolume;
-            FindWindowedCentroid(
-                *p);  // find local centroid using only i, j, xsig, ysig
-                      // now find sigmas based on full centroid
-            p->mXSig = sqrt(p->mXSig / p->mVolume -
-                            p->mXFullCentroid * p->mXFullCentroid + 0.0001);
-            p->mYSig = sqrt(p->mYSig / p->mVolume -
-                            p->mYFullCentroid * p->mYFullCentroid + 0.0001);
-#ifdef DBGPK
-            std::cout << i + 1 << " 9 " << p->mI << " " << p->mJ << " "
-                      << p->mCount << " " << p->mX << " " << p->mY << " "
-                      << p->mVolume << " " << p->mBorderBkgnd << " "
-                      << borderhits << " " << p->mHeight << std::endl;
-#endif
+            tiled[peaks[i].mJ / tilerows].push_back(i);
+        }
+
+        std::fill(hit.get(), hit.get() + (size_t)nmz * nrt, 0);
+        std::mutex merge;
+        std::vector<std::vector<int>> deferred(ntiles);
+        TAPP::Utilities::ParallelFor(ntiles, nthreads, [&](const size_t t) {
+            if (tiled[t].empty()) return;
+            int r0 = std::max(0, (int)t * tilerows - halorows);
+            int r1 = std::min(nrt, ((int)t + 1) * tilerows + halorows);
+            std::vector<int> labels((size_t)(r1 - r0) * nmz, 0);
+            MeshWindow window;
+            window.set(v.get() + Index(0, r0), labels.data(), nmz, nmz, nrt, 0,
+                       r0, nmz, r1);
+            for (int i : tiled[t]) {
+                if (!MeasurePeak(window, peaks[i], i, thresh, peakheightmin)) {
+                    deferred[t].push_back(i);
+                }
+            }
+            MergeLabels(r0, r1, labels.data(), merge);
+        });
+
+        // peaks too large for the halo get a window of their own, doubled
+        // until it holds them
+        std::vector<int> large;
+        for (const std::vector<int> &tile : deferred) {
+            large.insert(large.end(), tile.begin(), tile.end());
+        }
+        TAPP::Utilities::ParallelFor(large.size(), nthreads, [&](const size_t k) {
+            Peak &p = peaks[large[k]];
+            for (int h = 2 * halorows;; h *= 2) {
+                int r0 = std::max(0, p.mJ - h);
+                int r1 = std::min(nrt, p.mJ + h + 1);
+                std::vector<int> labels((size_t)(r1 - r0) * nmz, 0);
+                MeshWindow window;
+                window.set(v.get() + Index(0, r0), labels.data(), nmz, nmz,
+                           nrt, 0, r0, nmz, r1);
+                if (MeasurePeak(window, p, large[k], thresh, peakheightmin)) {
+                    MergeLabels(r0, r1, labels.data(), merge);
+                    break;
+                }
+            }
+        });
+
+        FinalizePeaks();
+    }
+
+    // merge the labels of rows [row0, row1) into hit
+    // FindPeaks leaves each cell with the label of the last peak to reach it,
+    // which is the one with the highest id, so keep the lowest label
+    // partial labels of a peak that left its window are a subset of its
+    // full labels and do no harm
+    void MergeLabels(const int row0, const int row1, const int *labels,
+                     std::mutex &lock) {
+        std::lock_guard<std::mutex> guard(lock);
+        int *h = hit.get() + Index(0, row0);
+        size_t n = (size_t)(row1 - row0) * mConversion.mNMZ;
+        for (size_t k = 0; k < n; k++) {
+            if (labels[k] < h[k]) h[k] = labels[k];
+        }
+    }
+
+    // describe the data and smoothing the peaks of this mesh are found in,
+    // to tell whether a CandidateCache still holds for it
+    CandidateCache::Source CandidateSource(const MeshSmoother &smoother) const {
+        CandidateCache::Source source;
+        source.mNMZ = mConversion.mNMZ;
+        source.mNRT = mConversion.mNRT;
+        source.mWarpedMesh = mConversion.mWarpedMesh;
+        source.mMassSpecType = mConversion.mMassSpecType;
+        source.mMinMZ = mConversion.mMinMZ;
+        source.mDMZ = mConversion.mDMZ;
+        source.mMinRT = mConversion.mMinRT;
+        source.mDRT = mConversion.mDRT;
+        source.mSigmaMZ = mConversion.mSigmaMZ;
+        source.mMZAtSigma = mConversion.mMZAtSigma;
+        std::error_code error;
+        source.mDatSize = std::filesystem::file_size(datname, error);
+        source.mDatTime = std::filesystem::last_write_time(datname, error)
+                              .time_since_epoch()
+                              .count();
+        if (smoother.Active()) source.mKernel = smoother.mKernel;
+        return source;
+    }
+
+    // Same as FindPeaks, keeping the local maxima and the explored peaks in
+    // the cache file, so that a later run on the same mesh with other
+    // npeaks, thresh or peakheightmin only explores the peaks whose stop
+    // height changed.  The data is only loaded, and smoothed, if the cache
+    // is missing, out of date or lacks a peak, so loadHeaderFromFile is
+    // enough before calling it.
+    void FindPeaksCached(int npeaks, double thresh, double peakheightmin,
+                         const char *cachename,
+                         const MeshSmoother &smoother) {
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        MeshWindow window;
+        bool loaded = false;
+        auto load = [&]() {
+            loaded = true;
+            std::string name(meshname);
+            loadFromFile(name.c_str());
+            Smooth(smoother);
+            window.set(v.get(), hit.get(), nmz, nmz, nrt, 0, 0, nmz, nrt);
+        };
+
+        CandidateCache cache;
+        const CandidateCache::Source source = CandidateSource(smoother);
+        bool changed = false;
+        if (!cache.Load(cachename) || cache.mSource != source) {
+            std::cout << "Finding the candidates of " << meshname << " for "
+                      << cachename << std::endl;
+            load();
+            cache = CandidateCache();
+            cache.mSource = source;
+            // all local maxima, so that any npeaks takes the first of them
+            PeakSelector selector(std::numeric_limits<int>::max());
+            std::vector<int> columns;
+            for (int y = 1; y < nrt - 1; y++) {
+                columns.clear();
+                window.FindRowPeaks(y, columns);
+                for (int x : columns) {
+                    selector.Add(x, y, v[Index(x, y)]);
+                }
+            }
+            cache.mCandidates = selector.Sorted();
+            changed = true;
+        }
+
+        if (npeaks < 0) npeaks = 0;
+        if ((size_t)npeaks > cache.mCandidates.size())
+            npeaks = cache.mCandidates.size();
+        cache.Reserve(npeaks);
+
+        peaks.clear();
+        peaks.reserve(npeaks);
+        for (int i = 0; i < npeaks; i++) {
+            const PeakCandidate &c = cache.mCandidates[i];
+            double stop =
+                CandidateCache::StopHeight(c.mHeight, thresh, peakheightmin);
+            if (cache.mStops[i] != stop) {
+                if (!loaded) load();
+                Peak p(c.mI, c.mJ, c.mHeight);
+                MeasurePeak(window, p, i, thresh, peakheightmin);
+                cache.mStops[i] = stop;
+                cache.mPeaks[i] = p;
+                changed = true;
+            }
+            peaks.push_back(cache.mPeaks[i]);
+        }
+
+        FinalizePeaks();
+        if (changed) cache.Save(cachename);
+    }
+
+    // Segment the whole mesh into peaks at once, instead of exploring them
+    // one by one.  The cells at least peakheightmin high are flooded from
+    // the highest down: a cell with no neighbour flooded before it starts a
+    // basin, and any other joins the basin of its highest neighbour, if it
+    // is at least thresh times that basin's maximum, or else is left out.
+    // Where basins meet, the first cell they share is their saddle, unless
+    // it is as high as one of them, which then is a plateau merged into the
+    // other.  The npeaks highest basins become the peaks, measured as
+    // MeasurePeak does over the basin and the cells bordering it.  Each
+    // cell is visited once, so the cost is that of sorting the cells above
+    // peakheightmin, however many peaks overlap.  hit is left with the
+    // number of each peak's cells plus one, and peak_saddles with the
+    // highest saddle of each peak.
+    void FindPeaksWatershed(int npeaks, double thresh, double peakheightmin) {
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        const size_t n = (size_t)nmz * nrt;
+        MeshWindow window;
+        window.set(v.get(), hit.get(), nmz, nmz, nrt, 0, 0, nmz, nrt);
+
+        // the cells to flood, highest first, equal heights in raster order
+        std::vector<std::pair<float, size_t>> cells;
+        for (int j = 1; j < nrt - 1; j++) {
+            for (int i = 1; i < nmz - 1; i++) {
+                float vv = v[Index(i, j)];
+                if (vv > 0 && vv >= peakheightmin) {
+                    cells.push_back({vv, (size_t)Index(i, j)});
+                }
+            }
+        }
+        std::sort(cells.begin(), cells.end(),
+                  [](const std::pair<float, size_t> &a,
+                     const std::pair<float, size_t> &b) {
+                      return a.first > b.first ||
+                             (a.first == b.first && a.second < b.second);
+                  });
+
+        // hit is 0 for cells not flooded yet, -1 for those left out, and the
+        // number of the basin plus one for the others
+        std::fill(hit.get(), hit.get() + n, 0);
+        std::vector<MeshBasin> basins;
+        auto find = [&basins](int b) {
+            while (basins[b].mParent != b) {
+                basins[b].mParent = basins[basins[b].mParent].mParent;
+                b = basins[b].mParent;
+            }
+            return b;
+        };
+        auto add = [&basins](const int b, const int i, const int j,
+                             const double vv) {
+            MeshBasin &basin = basins[b];
+            basin.mXSum += i * vv;
+            basin.mYSum += j * vv;
+            basin.mXSig += (double)i * i * vv;
+            basin.mYSig += (double)j * j * vv;
+            basin.mVSum += vv;
+            basin.mCount++;
+            basin.mIMin = std::min(basin.mIMin, i);
+            basin.mIMax = std::max(basin.mIMax, i);
+            basin.mJMin = std::min(basin.mJMin, j);
+            basin.mJMax = std::max(basin.mJMax, j);
+        };
+        // merge plateau basin b into basin into
+        auto merge = [&basins](const int b, const int into) {
+            MeshBasin &from = basins[b];
+            MeshBasin &to = basins[into];
+            from.mParent = into;
+            to.mXSum += from.mXSum;
+            to.mYSum += from.mYSum;
+            to.mXSig += from.mXSig;
+            to.mYSig += from.mYSig;
+            to.mVSum += from.mVSum;
+            to.mCount += from.mCount;
+            to.mIMin = std::min(to.mIMin, from.mIMin);
+            to.mIMax = std::max(to.mIMax, from.mIMax);
+            to.mJMin = std::min(to.mJMin, from.mJMin);
+            to.mJMax = std::max(to.mJMax, from.mJMax);
+            if (from.mSaddleBasin >= 0 &&
+                (to.mSaddleBasin < 0 || from.mSaddle > to.mSaddle)) {
+                to.mSaddle = from.mSaddle;
+                to.mSaddleBasin = from.mSaddleBasin;
+            }
+        };
+
+        // the maximum of a basin, to order basins as peak candidates
+        auto maximum = [&basins](const int b) {
+            return PeakCandidate{basins[b].mHeight, basins[b].mI,
+                                 basins[b].mJ};
+        };
+
+        static const int di[8] = {-1, +1, 0, 0, -1, +1, -1, +1};
+        static const int dj[8] = {0, 0, +1, -1, -1, +1, +1, -1};
+        for (const std::pair<float, size_t> &cell : cells) {
+            const double vv = cell.first;
+            const int i = cell.second % nmz;
+            const int j = cell.second / nmz;
+
+            // the basins around the cell, and the value of the highest
+            // neighbour in each
+            int around[8];
+            float highest[8];
+            int naround = 0;
+            bool flooded = false;
+            for (int d = 0; d < 8; d++) {
+                int label = hit[Index(i + di[d], j + dj[d])];
+                if (label == 0) continue;
+                flooded = true;
+                if (label < 0) continue;
+                int b = find(label - 1);
+                float vn = v[Index(i + di[d], j + dj[d])];
+                int a = 0;
+                while (a < naround && around[a] != b) a++;
+                if (a == naround) {
+                    around[naround] = b;
+                    highest[naround++] = vn;
+                } else if (vn > highest[a]) {
+                    highest[a] = vn;
+                }
+            }
 
-            p->mSNHeight = p->mHeight / p->mBorderBkgnd;
-            p->mSNVolume = p->mVolume / p->mCount / p->mBorderBkgnd;
+            if (!flooded) {
+                int b = basins.size();
+                basins.push_back({b, i, j, vv, 0, 0, 0, 0, 0, 0, i, i, j, j,
+                                  0, -1});
+                add(b, i, j, vv);
+                hit[cell.second] = b + 1;
+                continue;
+            }
 
-            // all above calcs should be in index space
-            // now convert to m/z space and account for warping
-            // coordinates and sigmas need to be mapped, including windowed
-            // centroids
+            // join or mark the meeting basins, the lower into the higher
+            for (int a = 0; a < naround; a++) {
+                for (int c = a + 1; c < naround; c++) {
+                    int b1 = find(around[a]);
+                    int b2 = find(around[c]);
+                    if (b1 == b2) continue;
+                    if (maximum(b2) < maximum(b1)) std::swap(b1, b2);
+                    if (vv == basins[b2].mHeight) {
+                        merge(b2, b1);
+                        continue;
+                    }
+                    if (basins[b1].mSaddleBasin < 0) {
+                        basins[b1].mSaddle = vv;
+                        basins[b1].mSaddleBasin = b2;
+                    }
+                    if (basins[b2].mSaddleBasin < 0) {
+                        basins[b2].mSaddle = vv;
+                        basins[b2].mSaddleBasin = b1;
+                    }
+                }
+            }
 
-            WarpPeakToMz(p);
+            // follow the highest neighbour, in a basin the cell is high
+            // enough for
+            int best = -1;
+            float bestv = 0;
+            for (int a = 0; a < naround; a++) {
+                int b = find(around[a]);
+                if (vv < thresh * basins[b].mHeight) continue;
+                if (best < 0 || highest[a] > bestv) {
+                    best = b;
+                    bestv = highest[a];
+                }
+            }
+            if (best < 0) {
+                hit[cell.second] = -1;
+            } else {
+                add(best, i, j, vv);
+                hit[cell.second] = best + 1;
+            }
+        }
 
-            // negative volume is sign of pathological peak
-            if (p->mVolume < 0 || p->mHeight < 0) {
-                p->mVolume = 0.1;
-                p->mHeight = 0.1;
-                p->mSNHeight = 0.001;
-                p->mSNVolume = 0.001;
+        // number the npeaks highest basins as the candidates of FindPeaks
+        std::vector<int> maxima;
+        for (size_t b = 0; b < basins.size(); b++) {
+            if (basins[b].mParent == (int)b) maxima.push_back(b);
+        }
+        std::sort(maxima.begin(), maxima.end(), [&](int b1, int b2) {
+            return maximum(b1) < maximum(b2);
+        });
+        if (npeaks < 0) npeaks = 0;
+        if ((size_t)npeaks < maxima.size()) maxima.resize(npeaks);
+        std::vector<int> number(basins.size(), -1);
+        for (size_t k = 0; k < maxima.size(); k++) number[maxima[k]] = k;
+
+        // label the cells with their peak, and add up the cells bordering
+        // each peak, once for each peak they border
+        for (const std::pair<float, size_t> &cell : cells) {
+            int label = hit[cell.second];
+            hit[cell.second] = label > 0 ? number[find(label - 1)] + 1 : 0;
+        }
+        std::vector<double> bordersum(maxima.size(), 0);
+        std::vector<int> borderhits(maxima.size(), 0);
+        for (int j = 1; j < nrt - 1; j++) {
+            for (int i = 1; i < nmz - 1; i++) {
+                int own = hit[Index(i, j)];
+                int counted[8];
+                int ncounted = 0;
+                for (int d = 0; d < 8; d++) {
+                    int label = hit[Index(i + di[d], j + dj[d])];
+                    if (label <= 0 || label == own) continue;
+                    int c = 0;
+                    while (c < ncounted && counted[c] != label) c++;
+                    if (c < ncounted) continue;
+                    counted[ncounted++] = label;
+                    bordersum[label - 1] += v[Index(i, j)];
+                    borderhits[label - 1]++;
+                }
             }
         }
 
-        std::vector<std::pair<int, Peak>> paired_peaks;
-        paired_peaks.reserve(peaks.size());
+        peaks.clear();
+        peaks.reserve(maxima.size());
+        for (size_t k = 0; k < maxima.size(); k++) {
+            const MeshBasin &basin = basins[maxima[k]];
+            Peak q(basin.mI, basin.mJ, basin.mHeight);
+            StartPeak(q, k);
+            q.mXFullCentroid += basin.mXSum;
+            q.mYFullCentroid += basin.mYSum;
+            q.mXSig += basin.mXSig;
+            q.mYSig += basin.mYSig;
+            q.mVolume += basin.mVSum;
+            q.mCount += basin.mCount;
+            window.mIMin = basin.mIMin;
+            window.mIMax = basin.mIMax;
+            window.mJMin = basin.mJMin;
+            window.mJMax = basin.mJMax;
+            FinishPeak(window, q, bordersum[k], borderhits[k]);
+            peaks.push_back(q);
+        }
+
+        FinalizePeaks();
+
+        peak_saddles.assign(peaks.size(), {0, -1});
+        for (size_t k = 0; k < maxima.size(); k++) {
+            const MeshBasin &basin = basins[maxima[k]];
+            if (!indexed_peaks[k] || basin.mSaddleBasin < 0) continue;
+            int other = number[find(basin.mSaddleBasin)];
+            if (other < 0 || !indexed_peaks[other]) continue;
+            peak_saddles[indexed_peaks[k] - peaks.data()] = {
+                basin.mSaddle, (int)(indexed_peaks[other] - peaks.data())};
+        }
+    }
+
+    // explore the neighbourhood of peak p, which becomes peak number index,
+    // and find its centroids, sigmas and s/n
+    // returns false, leaving p untouched, if window is too small for it
+    bool MeasurePeak(MeshWindow &window, Peak &p, const int index,
+                     const double thresh, const double peakheightmin) const {
+        Peak q = p;
+        StartPeak(q, index);
+        double bordersum = 0;
+        int borderhits = 0;
+        window.mOverflow = false;
+        window.ResetExtent(q.mI, q.mJ);
+        window.ExplorePeakSlope2(index + 1, q.mI, q.mJ, q.mHeight, thresh,
+                                 peakheightmin, -1, q.mXFullCentroid,
+                                 q.mYFullCentroid, q.mXSig, q.mYSig, q.mVolume,
+                                 q.mCount);
+        window.FindBoundary(index + 1, q.mI, q.mJ, bordersum, borderhits);
+        if (window.mOverflow) return false;
+        if (!FinishPeak(window, q, bordersum, borderhits)) return false;
+        p = q;
+        return true;
+    }
+
+    // start the sums of peak q, which becomes peak number index, with its
+    // maximum.  the region around it is added to them, maximum included
+    static void StartPeak(Peak &q, const int index) {
+        q.mID = index;
+        q.mCount = 1;
+        double x = q.mI;  // xcoord(q.mI);
+        double y = q.mJ;  // ycoord(q.mJ);
+        q.mXPeak = x;
+        q.mYPeak = y;
+        q.mXFullCentroid = q.mHeight * x;
+        q.mYFullCentroid = q.mHeight * y;
+        q.mXSig = q.mHeight * x * x;
+        q.mYSig = q.mHeight * y * y;
+        q.mVolume = q.mHeight;
+    }
+
+    // turn the sums of peak q over its region, and of the border around it,
+    // into its centroids, sigmas and s/n, and map it to m/z and RT
+    // the extent of the region is that of window
+    // returns false if the window is too small for the windowed centroid
+    bool FinishPeak(MeshWindow &window, Peak &q, const double bordersum,
+                    int borderhits) const {
+        if (borderhits < 1) borderhits = 1;
+        q.mBorderBkgnd = bordersum / borderhits;
+        // this is full centroid
+        q.mXFullCentroid /= q.mVolume;
+        q.mYFullCentroid /= q.mVolume;
+        // find local centroid using only i, j, xsig, ysig
+        if (!window.FindWindowedCentroid(q)) return false;
+        // now find sigmas based on full centroid
+        q.mXSig = sqrt(q.mXSig / q.mVolume -
+                       q.mXFullCentroid * q.mXFullCentroid + 0.0001);
+        q.mYSig = sqrt(q.mYSig / q.mVolume -
+                       q.mYFullCentroid * q.mYFullCentroid + 0.0001);
+
+        q.mSNHeight = q.mHeight / q.mBorderBkgnd;
+        q.mSNVolume = q.mVolume / q.mCount / q.mBorderBkgnd;
+
+        // all above calcs should be in index space
+        // now convert to m/z space and account for warping
+        // coordinates and sigmas need to be mapped, including windowed
+        // centroids
+
+        q.mXMin = window.mIMin;
+        q.mXMax = window.mIMax;
+        q.mYMin = window.mJMin;
+        q.mYMax = window.mJMax;
+        WarpPeakToMz(&q);
+
+        // negative volume is sign of pathological peak
+        if (q.mVolume < 0 || q.mHeight < 0) {
+            q.mVolume = 0.1;
+            q.mHeight = 0.1;
+            q.mSNHeight = 0.001;
+            q.mSNVolume = 0.001;
+        }
+        return true;
+    }
+
+    // drop the single point peaks, order the rest by height and index them
+    // by their number from the exploration
+    void FinalizePeaks() {
+        // orders the peak numbers rather than the peaks, so that each Peak is
+        // only moved once, into its final place
+        std::vector<int> order;
+        order.reserve(peaks.size());
 
         size_t size = peaks.size();
         for (size_t p = 0; p < size; ++p) {
-            paired_peaks.push_back({p, peaks[p]});
+            if (peaks[p].mCount > 1) order.push_back(p);
         }
 
-        paired_peaks.erase(
-            std::remove_if(paired_peaks.begin(), paired_peaks.end(),
-                           [](const std::pair<int, Peak> &peak) {
-                               if (peak.second.mCount > 1) {
-                                   return false;
-                               } else {
-                                   return true;
-                               }
-                           }),
-            paired_peaks.end());
-
-        std::sort(paired_peaks.begin(), paired_peaks.end(), IndexedSigSort);
+        std::sort(order.begin(), order.end(), [this](int p1, int p2) {
+            return SigSort(peaks[p1], peaks[p2]);
+        });
 
-        // Cleans the Mesh.peaks and Mesh.indexed_peaks std::vectors and
-        // reserves the required amount of elements.
-        peaks.clear();
+        // Refills the Mesh.peaks std::vector in that order.
+        // indexed_peaks is indexed by the number from the exploration, so it
+        // keeps an empty entry for each dropped peak
+        std::vector<Peak> found;
+        found.swap(peaks);
         indexed_peaks.clear();
-        peaks.reserve(paired_peaks.size());
-        indexed_peaks.resize(paired_peaks.size());
-
-        // Fills the Mesh.peaks std::vector with peaks;
-        for (std::pair<int, Peak> &paired_peak : paired_peaks) {
-            peaks.push_back(std::move(paired_peak.second));
-            indexed_peaks[paired_peak.first] = &peaks.back();
-        }
-    }
-
-    // go +/- 4 around peak and find weighted centroid
-    // also find weighted s/n
-    void FindWindowedCentroid(Peak &p) {
-        enum { RCENT = 1 };
-        enum { RWID = 4 * RCENT };
-        double invrsq = 1.0 / (RCENT * RCENT);
-        double xwsum = 0;
-        double ywsum = 0;
-        double xsum = 0;
-        double ysum = 0;
-        double wvsum = 0;
-        double wbksum = 0;
-        double wsum = 0;  // sum of w
-        double vsum = 0;
-        double xvsum = 0;
-        double yvsum = 0;
-        int imin = p.mI - RWID;
-        if (imin < 0) imin = 0;
-        int imax = p.mI + RWID + 1;
-        if (imax > mConversion.mNMZ) imax = mConversion.mNMZ;
-        int jmin = p.mJ - RWID;
-        if (jmin < 0) jmin = 0;
-        int jmax = p.mJ + RWID + 1;
-        if (jmax > mConversion.mNRT) jmax = mConversion.mNRT;
-        float *pv;
-
-		for (int j = jmin; j < jmax; j++) {
-            pv = v.get() + j * mConversion.mNMZ + imin;  // v.get() instead of v
-            for (int i = imin; i < imax; i++, pv++) {
-                int di = p.mI - i;
-                int dj = p.mJ - j;
-                double w = exp(-0.5 * (di * di + dj * dj) * invrsq);
-                double vv = *pv;
-                double wv = vv * w;
-                xvsum += i * vv;
-                yvsum += j * vv;
-                vsum += vv;
-                wsum += w;        // sum of weights alone
-                xwsum += wv * i;  // wv*xcoord(i);
-                ywsum += wv * j;  // wv*ycoord(j);
-                xsum += i;
-                ysum += j;
-                wvsum += wv;  // sum of weights*v
-                wbksum += w * p.mBorderBkgnd;
+        peaks.reserve(order.size());
+        indexed_peaks.resize(size, nullptr);
+
+        for (int p : order) {
+            peaks.push_back(std::move(found[p]));
+            indexed_peaks[p] = &peaks.back();
+        }
+    }
+
+    // write the region id of each peak found by FindPeaksInRegions,
+    // numbered as in DumpPeaks
+    void DumpPeakRegions(std::ostream &sout) const {
+        sout << "N Region\n";
+        for (size_t i = 0; i < peak_regions.size(); i++) {
+            sout << i << ' ' << peak_regions[i] << '\n';
+        }
+    }
+
+    // write the highest saddle of each peak found by FindPeaksWatershed and
+    // the peak on its other side, numbered as in DumpPeaks
+    void DumpPeakSaddles(std::ostream &sout) const {
+        sout << "N Saddle Peak\n";
+        for (size_t i = 0; i < peak_saddles.size(); i++) {
+            sout << i << ' ' << peak_saddles[i].mHeight << ' '
+                 << peak_saddles[i].mPeak << '\n';
+        }
+    }
+
+    // write the peak owning each cell, numbered as in DumpPeaks, to an LBL
+    // file.  hit must hold the labels of a search of the whole mesh, where
+    // the cells of peak number n from the exploration are labelled n + 1 or
+    // -(n + 1).  FindPeaks gives a cell to the last peak reaching it,
+    // border included, FindPeaksWatershed to the basin it lies in
+    void DumpLabelMap(const std::string &filepath) const {
+        const int nmz = mConversion.mNMZ;
+        const int nrt = mConversion.mNRT;
+        TAPP::Filetypes::TAPP::LBL_Writer writer(filepath, nmz, nrt,
+                                                 peaks.size());
+        std::vector<int32_t> row(nmz);
+        for (int j = 0; j < nrt; j++) {
+            const int *h = hit.get() + Index(0, j);
+            for (int i = 0; i < nmz; i++) {
+                size_t n = std::abs(h[i]);
+                const Peak *p = n > 0 && n <= indexed_peaks.size()
+                                    ? indexed_peaks[n - 1]
+                                    : nullptr;
+                row[i] = p ? p - peaks.data() : -1;
             }
+            writer.WriteRow(row.data());
         }
-        p.mX = xvsum / vsum;
-        p.mY = yvsum / vsum;
-        p.mVCentroid = vsum;
-        p.mHeight = wvsum / wsum;
-        if (wvsum <= wbksum || wbksum == 0) {
-            p.mSNCentroid = 0.001;
-        } else {
-            p.mSNCentroid = (wvsum) / wbksum;
-        }
+        writer.Close();
     }
 
     void DumpPeaks() { DumpPeaks(std::cout); }
 
-    static void DumpPeaks(std::vector<Peak> peaks, std::ostream &sout) {
+    // write the peaks as a .pks file, formatted on nthreads threads, 0 for
+    // one per core
+    static void DumpPeaks(const std::vector<Peak> &peaks, std::ostream &sout,
+                          const int nthreads = 0) {
         int npeaks = peaks.size();
         std::vector<TAPP::Filetypes::TAPP::PKS> output_vector;
         output_vector.reserve(npeaks);
 
         for (int i = 0; i < npeaks; i++) {
-            Peak p = peaks[i];
+            const Peak &p = peaks[i];
             output_vector.push_back({(size_t)i, p.mX, p.mY, p.mHeight,
                                      p.mVolume, p.mVCentroid, p.mXSig, p.mYSig,
                                      (size_t)p.mCount, p.mBorderBkgnd,
@@ -1853,19 +3568,123 @@ public:
 
         TAPP::Filetypes::TAPP::SetGlobalPrecision(sout);
         TAPP::Filetypes::TAPP::WritePKS(sout, output_vector, {'\n', ' ', '\"'},
-                                        true);
+                                        true, nthreads);
+    }
+
+    void DumpPeaks(std::ostream &sout, const int nthreads = 0) {
+        DumpPeaks(peaks, sout, nthreads);
+    }
+
+    // write the peaks as a binary .pkb file, numbered as in DumpPeaks
+    static void DumpPeaksBinary(const std::vector<Peak> &peaks,
+                                const std::string &filepath,
+                                const bool compress = true) {
+        std::vector<TAPP::Filetypes::TAPP::PKS> records;
+        std::vector<TAPP::Filetypes::TAPP::PKB_Bounds> bounds;
+        records.reserve(peaks.size());
+        bounds.reserve(peaks.size());
+
+        for (size_t i = 0; i < peaks.size(); i++) {
+            const Peak &p = peaks[i];
+            records.push_back({i, p.mX, p.mY, p.mHeight, p.mVolume,
+                               p.mVCentroid, p.mXSig, p.mYSig,
+                               (size_t)p.mCount, p.mBorderBkgnd, p.mSNVolume,
+                               p.mSNHeight, p.mSNCentroid});
+            bounds.push_back({p.mXMin, p.mXMax, p.mYMin, p.mYMax});
+        }
+
+        TAPP::Filetypes::TAPP::WritePKB(filepath, records, bounds, compress);
+    }
+
+    void DumpPeaksBinary(const std::string &filepath,
+                         const bool compress = true) {
+        DumpPeaksBinary(peaks, filepath, compress);
+    }
+
+    // read a .pkb file written by DumpPeaksBinary
+    // fills a std::vector<Peak> or a PeakTable
+    template <class PeakContainer>
+    static void loadPeaksBinary(PeakContainer &thePeaks,
+                                const std::string &peakFilename,
+                                int FileID = 0, int Class = 0) {
+        TAPP::Filetypes::TAPP::PKB_File pkb =
+            TAPP::Filetypes::TAPP::ParsePKB(peakFilename);
+        std::cout << "Loading binary peak file " << peakFilename << " with "
+                  << pkb.records.size() << " peaks." << std::endl;
+
+        thePeaks.reserve(thePeaks.size() + pkb.records.size());
+        for (size_t i = 0; i < pkb.records.size(); i++) {
+            const TAPP::Filetypes::TAPP::PKS &r = pkb.records[i];
+            const TAPP::Filetypes::TAPP::PKB_Bounds &b = pkb.bounds[i];
+            Peak newPeak;
+            newPeak.mID = r.id;
+            newPeak.mX = r.mz;
+            newPeak.mY = r.rt;
+            newPeak.mHeight = r.intensity;
+            newPeak.mVolume = r.volume;
+            newPeak.mVCentroid = r.v_centroid;
+            newPeak.mXSig = r.mz_sigma;
+            newPeak.mYSig = r.rt_sigma;
+            newPeak.mCount = r.count;
+            newPeak.mBorderBkgnd = r.local_background;
+            newPeak.mSNVolume = r.sn_volume;
+            newPeak.mSNHeight = r.sn_height;
+            newPeak.mSNCentroid = r.sn_centroid;
+            newPeak.mXMin = b.mz_min;
+            newPeak.mXMax = b.mz_max;
+            newPeak.mYMin = b.rt_min;
+            newPeak.mYMax = b.rt_max;
+            newPeak.mClass = Class;
+            newPeak.mFile = FileID;
+            thePeaks.push_back(newPeak);
+        }
+    }
+
+    // replace the peaks with the selected candidates, highest first
+    void SetPeaks(PeakSelector &selector) {
+        const std::vector<PeakCandidate> &selected = selector.Sorted();
+        peaks.clear();
+        peaks.reserve(selected.size());
+        for (const PeakCandidate &c : selected) {
+            peaks.push_back(
+                Peak(c.mI, c.mJ, c.mHeight));  // for warped peak don't need to
+                                               // know x, y at this point -
+                                               // just indices
+        }
     }
 
-    void DumpPeaks(std::ostream &sout) { DumpPeaks(peaks, sout); }
+    // read regions, one per line as: id mzmin mzmax rtmin rtmax
+    // blank lines, lines starting with # and a header line are skipped
+    static std::vector<MeshRegion> loadRegions(const std::string &filename) {
+        std::ifstream inFile(filename.c_str());
+        if (!inFile) {
+            std::cerr << "Error - cannot open region file " << filename
+                      << std::endl;
+            exit(-1);
+        }
 
-    inline void AddPeak(int i, int j, int npeaks) {
-        if (peaks.size() >= npeaks * 1.5) {
-            sort(peaks.begin(), peaks.end());
-            peaks.erase(peaks.begin() + npeaks, peaks.end());
+        std::vector<MeshRegion> regions;
+        std::string line;
+        int nline = 0;
+        while (getline(inFile, line)) {
+            nline++;
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') continue;
+
+            std::stringstream iss(line);
+            MeshRegion region;
+            if (!(iss >> region.mID >> region.mMZMin >> region.mMZMax >>
+                  region.mRTMin >> region.mRTMax)) {
+                if (regions.empty() && !isdigit((unsigned char)line[first]))
+                    continue;
+                std::cerr << "Error - line " << nline << " of " << filename
+                          << " is not: id mzmin mzmax rtmin rtmax"
+                          << std::endl;
+                exit(-1);
+            }
+            regions.push_back(region);
         }
-        peaks.push_back(
-            Peak(i, j, v[Index(i, j)]));  // for warped peak don't need to know
-                                          // x, y at this point - just indices
+        return regions;
     }
 
     static int getNTokens(std::string &s) {
@@ -1907,9 +3726,15 @@ public:
     // N X Y Height Volume VCentroid XSigma YSigma Count LocalBkgnd SNVolume
     // SNHeight SNCentroid  > 6 N X Y Height XSigma YSigma = 6 X Y Height XSigma
     // YSigma = 5 N X Y Height = 4 X Y Height = 3
-    static void loadPeaks(std::vector<Peak> &thePeaks, std::string peakFilename,
+    template <class PeakContainer>
+    static void loadPeaks(PeakContainer &thePeaks, std::string peakFilename,
                           int FileID = 0, int Class = 0, double xwidth = 0.2,
                           double ywidth = 0.2) {
+        if (TAPP::Filetypes::TAPP::IsPKB(peakFilename)) {
+            loadPeaksBinary(thePeaks, peakFilename, FileID, Class);
+            return;
+        }
+
         std::ifstream inFile(peakFilename.c_str());
         std::string fileRecord;
         getline(inFile, fileRecord);  // Skip header record.
@@ -2029,17 +3854,17 @@ public:
         return thePeaks;
     }
 
-    static std::vector<Peak> cullPeaks(std::vector<Peak> pall,
-                                       std::vector<double> kill, double w,
-                                       int ndesired, double maxmzwidth,
-                                       double maxrtwidth) {
+    static std::vector<Peak> cullPeaks(const std::vector<Peak> &pall,
+                                       const std::vector<double> &kill,
+                                       double w, int ndesired,
+                                       double maxmzwidth, double maxrtwidth) {
         std::vector<Peak> thePeaks;
         int npeaks = pall.size();
         int nkill = kill.size();
 
         int ngood = 0;
         for (int i = 0; i < npeaks && ngood < ndesired; i++) {
-            Peak p = pall[i];
+            const Peak &p = pall[i];
             if (p.mXSig > maxmzwidth || p.mYSig > maxrtwidth) continue;
             bool good = true;
             for (int j = 0; j < nkill; j++) {
@@ -2056,7 +3881,8 @@ public:
         return thePeaks;
     }
 
-    static std::vector<Peak> cullPeaks(std::vector<Peak> pall, char *fname,
+    static std::vector<Peak> cullPeaks(const std::vector<Peak> &pall,
+                                       const char *fname,
                                        double w, int ndesired,
                                        double maxmzwidth, double maxrtwidth) {
         std::vector<double> kill;
@@ -2075,9 +3901,9 @@ public:
         return cullPeaks(pall, kill, w, ndesired, maxmzwidth, maxrtwidth);
     }
 
-    static DoubleMatrix &makeSimpleTICFromPeaks(std::vector<Peak> thePeaks,
-                                                float ymin, float ymax,
-                                                float dy, float heightTh0 = 0) {
+    static DoubleMatrix &makeSimpleTICFromPeaks(
+        const std::vector<Peak> &thePeaks, float ymin, float ymax, float dy,
+        float heightTh0 = 0) {
         int numPoints = (ymax - ymin) / dy + 1;
         double squeeze = 3.0;
 
@@ -2087,7 +3913,7 @@ public:
         float GaussFactor = 1.0;
 
         for (int i = 0; i < (int)thePeaks.size(); i++) {
-            Peak thePeak = thePeaks[i];
+            const Peak &thePeak = thePeaks[i];
 
             // Ignore peaks below height threshold.
             if (thePeak.mHeight < heightTh0) continue;
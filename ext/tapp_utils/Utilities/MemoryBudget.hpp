@@ -0,0 +1,63 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+namespace TAPP::Utilities
+{
+	/// <summary>
+	/// Lets worker threads reserve memory from a shared budget before they allocate it, waiting while the rest of the budget is reserved.
+	/// A reservation larger than the whole budget is granted once nothing else is reserved, so it runs on its own rather than not at all.
+	/// </summary>
+	class MemoryBudget
+	{
+		public:
+			/// <summary>Initializes the budget.</summary>
+			/// <param name="budget">The amount of bytes that can be reserved at once, 0 for no limit.</param>
+			MemoryBudget(const size_t budget = 0) : m_budget_(budget), m_reserved_(0)
+			{
+			}
+
+			/// <summary>Waits until the bytes fit in the budget and reserves them.</summary>
+			/// <param name="size">The amount of bytes to reserve.</param>
+			void Acquire(const size_t size)
+			{
+				std::unique_lock<std::mutex> lock(m_mutex_);
+				m_released_.wait(lock, [&]()
+				{
+					return m_budget_ == 0 || m_reserved_ == 0 || m_reserved_ + size <= m_budget_;
+				});
+				m_reserved_ += size;
+			}
+
+			/// <summary>Returns bytes reserved with Acquire to the budget.</summary>
+			/// <param name="size">The amount of bytes to release.</param>
+			void Release(const size_t size)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex_);
+					m_reserved_ -= size;
+				}
+				m_released_.notify_all();
+			}
+
+			/// <summary>Returns the amount of bytes that can be reserved at once, 0 for no limit.</summary>
+			size_t Budget(void) const
+			{
+				return m_budget_;
+			}
+
+		private:
+			/*** Variables **************************************************************/
+
+			size_t					m_budget_;
+			size_t					m_reserved_;
+			std::mutex				m_mutex_;
+			std::condition_variable	m_released_;
+	};
+}
@@ -0,0 +1,61 @@
+// Copyright 2019, IBM Corporation
+// 
+// This source code is licensed under the Apache License, Version 2.0 found in
+// the LICENSE.md file in the root directory of this source tree.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace TAPP::Utilities
+{
+	/// <summary>Returns the amount of threads to use when the caller asks for thread_count, where 0 means one per hardware thread.</summary>
+	inline size_t ResolveThreadCount(size_t thread_count)
+	{
+		if (thread_count == 0)
+		{
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+		}
+		return thread_count;
+	}
+
+	/// <summary>Calls task(0) to task(task_count - 1) on a set of worker threads that pick the next index when they finish one.</summary>
+	/// <param name="task_count">The amount of tasks to run.</param>
+	/// <param name="thread_count">The amount of worker threads, 0 for one per hardware thread. A single thread runs the tasks in order on the calling thread.</param>
+	/// <param name="task">A callable accepting the task index. Tasks must not depend on the order in which they run.</param>
+	template <typename Task>
+	void ParallelFor(const size_t task_count, size_t thread_count, Task task)
+	{
+		thread_count = std::min(ResolveThreadCount(thread_count), task_count);
+		if (thread_count <= 1)
+		{
+			for (size_t t = 0; t < task_count; ++t)
+			{
+				task(t);
+			}
+			return;
+		}
+
+		std::atomic<size_t> next_task(0);
+		std::vector<std::thread> workers;
+		workers.reserve(thread_count);
+		for (size_t w = 0; w < thread_count; ++w)
+		{
+			workers.emplace_back([&]()
+			{
+				for (size_t t = next_task++; t < task_count; t = next_task++)
+				{
+					task(t);
+				}
+			});
+		}
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+}
@@ -6,6 +6,7 @@
 #include "Utilities/StringManipulation.h"
 
 #include <algorithm>
+#include <cctype>
 #include <stdexcept>
 
 namespace TAPP::Utilities::StringManipulation
@@ -106,6 +107,57 @@ namespace TAPP::Utilities::StringManipulation
 		return string.substr(position, length);
 	}
 
+	// Returns a view of the characters between the brackets, without copying them. The view is empty if either bracket is missing.
+	std::string_view GetEmbeddedView(const std::string_view string, const char opening_bracket, const char closing_bracket, const size_t start)
+	{
+		size_t position = string.find(opening_bracket, start);
+		if (position == std::string_view::npos)
+		{
+			return std::string_view();
+		}
+
+		++position;
+		size_t end = string.find(closing_bracket, position);
+		if (end == std::string_view::npos)
+		{
+			return std::string_view();
+		}
+
+		return string.substr(position, end - position);
+	}
+
+	// Returns a view of the value of an XML attribute within a tag, or an empty view if the tag lacks the attribute.
+	std::string_view GetAttributeView(const std::string_view tag, const std::string_view name)
+	{
+		for (size_t position = tag.find(name); position != std::string_view::npos; position = tag.find(name, position + 1))
+		{
+			// Only accepts whole attribute names, followed by an equals sign and a quoted value.
+			if (position == 0 || !isspace((unsigned char)tag[position - 1]))
+			{
+				continue;
+			}
+
+			size_t equals = position + name.size();
+			while (equals < tag.size() && isspace((unsigned char)tag[equals]))
+			{
+				++equals;
+			}
+			if (equals >= tag.size() || tag[equals] != '=')
+			{
+				continue;
+			}
+
+			size_t quote = tag.find_first_of("\"'", equals + 1);
+			if (quote == std::string_view::npos)
+			{
+				return std::string_view();
+			}
+			return GetEmbeddedView(tag, tag[quote], tag[quote], quote);
+		}
+
+		return std::string_view();
+	}
+
 	/*** String Acquisition *****************************************************/
 
 	// Acquires the amount of lines within a file.
@@ -5,7 +5,9 @@
 
 #pragma once
 
+#include <charconv>
 #include <string>
+#include <string_view>
 #include <vector>
 
 /*
@@ -36,8 +38,29 @@ namespace TAPP::Utilities::StringManipulation
 	std::string GetEmbeddedCharacters(const std::string& string, const char opening_bracket, const char closing_bracket);
 	std::string GetEmbeddedCharacters(const std::string& string, const char opening_bracket, const char closing_bracket, const size_t start);
 
+	std::string_view GetEmbeddedView(const std::string_view string, const char opening_bracket, const char closing_bracket, const size_t start = 0);
+
+	std::string_view GetAttributeView(const std::string_view tag, const std::string_view name);
+
 	std::string GetLines(const std::string& text, const size_t line_a, const size_t line_b);
 	std::string GetLines(const std::string& text, const size_t line_a, const size_t line_b, size_t& lines_read);
 
 	std::vector<std::string> Split(const std::string& list, char delimiter);
-}
\ No newline at end of file
+
+	// Converts the number held by the text, ignoring surrounding whitespace and a leading plus sign. Returns fallback if the text holds no number.
+	template <typename T>
+	T ParseNumber(std::string_view text, const T fallback = T())
+	{
+		while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\n' || text.front() == '\r' || text.front() == '+'))
+		{
+			text.remove_prefix(1);
+		}
+
+		T value;
+		if (std::from_chars(text.data(), text.data() + text.size(), value).ec != std::errc())
+		{
+			return fallback;
+		}
+		return value;
+	}
+}
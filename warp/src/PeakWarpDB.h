@@ -8,8 +8,8 @@
 #define PeakWarpDB_h_
 
 #include <string>
+#include <utility>
 #include <vector>
-#include <map>
 
 class DoubleMatrix;
 class Mesh;
@@ -23,56 +23,24 @@ public:
 	string errMessage;
 };
 
-class PeakWarpDBEntry {
-public:
-	PeakWarpDBEntry(Peak& thePeak) {
-		peak = thePeak; keep = true;
-	}
-	Peak peak;
-	bool keep;
-};
-
-typedef map<double, PeakWarpDBEntry*> MZTree;
-
 //
-// Organizes peaks first by RT then by M/Z.
+// Organizes peaks first by RT then by M/Z, as the rows of a PeakTable, so the
+// peaks of an RT band are a run of consecutive rows.
 //
 class PeakWarpDB {
-	friend class PeakWarpDBIterator;
-
-	//stree rtTree;
-	map<double, MZTree*> rtTree;
+	PeakTable peaks;
 	int sampleIdx;
 
 public:
-	PeakWarpDB(int theSampleIdx);
-	~PeakWarpDB();
+	PeakWarpDB(int theSampleIdx, const PeakTable& thePeaks);
 
-	void addPeak(Peak& thePeak);
-	PeakWarpDBEntry* getPeakDBEntry(Peak& thePeak);
+	const PeakTable& getPeaks() { return peaks; }
 
 	double getPeakMinRT();
 	double getPeakMaxRT();
-	vector<Peak> getPeaksAtRTBand(double rtCenter, double rtWidth);
-};
-
-class PeakWarpDBIterator {
-	PeakWarpDB *peakWarpDB;
-	//
-	map<double, MZTree*>::iterator rtTreePos;
-	MZTree *curntList;
-	MZTree::iterator mzTreePos;
-	PeakWarpDBEntry *curntPeak;
-public:
-	PeakWarpDBIterator(PeakWarpDB* thePeakWarpDB) { 
-		peakWarpDB = thePeakWarpDB; init();
-	}
-
-	void init();
-	void init(double startRT);
-	Peak nextP();
-	PeakWarpDBEntry* nextE();
-	bool done(); // Check done() status before calling next().
+	// The rows [first, second) with an RT within rtWidth of rtCenter.
+	pair<size_t, size_t> getRowsAtRTBand(double rtCenter, double rtWidth);
+	PeakTable::Columns getPeaksAtRTBand(double rtCenter, double rtWidth);
 };
 
 #endif 
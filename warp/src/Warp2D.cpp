@@ -43,79 +43,95 @@ void Warp2D::computeWarp(vector<Peak>& referencePeaks, vector<Peak>& samplePeaks
 	cow_2D(referencePeaks, samplePeaks, nTimePoints, windowSize_m, slack_t);
 }
 
-double Warp2D::similarity2D(double refTimeStart, double refTimeSeg, vector<Peak>& refPeaks,
-							double smpTimeStart, double smpTimeSeg, vector<Peak>& smpPeaks) {
+double Warp2D::similarity2D(double refTimeStart, double refTimeSeg, const PeakTable::Columns& refPeaks,
+							double smpTimeStart, double smpTimeSeg, const PeakTable::Columns& smpPeaks) {
 	//
-	// Warp sample peaks to reference time.
-	int smpCount = (int)smpPeaks.size(); 
-	for (int j=0; j < smpCount; j++) { 
-		Peak& smpPeak = smpPeaks[j];
-		// Notice we are modifying the sample peaks time values. The changes will be
-		// be visible to the caller.
-		smpPeak.mY = (smpPeak.mY-smpTimeStart)*(refTimeSeg)/smpTimeSeg+refTimeStart;
+	// Warp sample peaks to reference time. The warped times go to a scratch
+	// column, so the sample peaks stay as they are.
+	smpWarpedRT.resize(smpPeaks.size);
+	for (size_t j=0; j < smpPeaks.size; j++) { 
+		smpWarpedRT[j] = (smpPeaks.rt[j]-smpTimeStart)*(refTimeSeg)/smpTimeSeg+refTimeStart;
 	}
-	return similarity2D(refPeaks, smpPeaks);
+	PeakTable::Columns warpedPeaks = smpPeaks;
+	warpedPeaks.rt = smpWarpedRT.data();
+	return similarity2D(refPeaks, warpedPeaks);
 }
 
 double Warp2D::similarity2D( vector<Peak>& refPeaks,vector<Peak>& smpPeaks) {
+	PeakTable refTable(refPeaks);
+	PeakTable smpTable(smpPeaks);
+	return similarity2D(refTable.View(), smpTable.View());
+}
+
+double Warp2D::similarity2D(const PeakTable::Columns& refPeaks, const PeakTable::Columns& smpPeaks) {
     double similVal=0;
     //
     // Compute overlap among all peaks.
     //
-    int smpCount = (int)smpPeaks.size(); 
+    int smpCount = (int)smpPeaks.size; 
 
     // if either sample count is small, or max peaks per segment has been specified...
     if (smpCount<100 || maxNPeaksPSegmt>0) {
-        int refCount = (int)refPeaks.size(); 
+        int refCount = (int)refPeaks.size; 
         if (debug2)
             fprintf(f, "similarity %d against %d\n", smpCount, refCount);
         for (int i=0; i<refCount; i++) {
-            Peak& refPeak = refPeaks[i];
             for (int j=0; j<smpCount; j++) {
-                Peak& smpPeak = smpPeaks[j];
-                similVal += peakOverlap(refPeak, smpPeak);
+                similVal += peakOverlap(refPeaks, i, smpPeaks, j);
                 if (debug2)
                     fprintf(f, "simsum %d %d %f\n", i, j, similVal);
             }
         }
     } else {
-        PeakMatchDB *smpDB = new PeakMatchDB(0);
-        for (int j=0; j<smpCount; j++) {
-            Peak& smpPeak = smpPeaks[j];
-            smpDB->addPeak(smpPeak);
-        }
-        int refCount = (int)refPeaks.size(); 
+        // Order the sample peaks by M/Z, then RT, dropping the duplicates.
+        vector<size_t> byMZ(smpCount);
+        for (int j=0; j<smpCount; j++)
+            byMZ[j] = j;
+        stable_sort(byMZ.begin(), byMZ.end(), [&smpPeaks](size_t j1, size_t j2) {
+            if (smpPeaks.mz[j1]!=smpPeaks.mz[j2])
+                return smpPeaks.mz[j1]<smpPeaks.mz[j2];
+            return smpPeaks.rt[j1]<smpPeaks.rt[j2];
+        });
+        byMZ.erase(unique(byMZ.begin(), byMZ.end(), [&smpPeaks](size_t j1, size_t j2) {
+            if (smpPeaks.mz[j1]==smpPeaks.mz[j2] && smpPeaks.rt[j1]==smpPeaks.rt[j2]) {
+                cout << "PeakMatchDB> Duplicate peak ? Ignoring ..." << endl;
+                return true;
+            }
+            return false;
+        }), byMZ.end());
+        vector<double> sortedMZ(byMZ.size());
+        for (size_t k=0; k<byMZ.size(); k++)
+            sortedMZ[k] = smpPeaks.mz[byMZ[k]];
+
+        int refCount = (int)refPeaks.size; 
         for (int i=0; i<refCount; i++) {
-            Peak& refPeak = refPeaks[i];
-            vector<Peak> mzdummy = smpDB->getPeaksAtMZBand(refPeak.mX,5);  // why 5??
-
-            vector<Peak> &mzBandSmpPeaks = mzdummy;
-            int bpkCount = (int)mzBandSmpPeaks.size();
-            for (int j=0; j<bpkCount; j++) {
-                Peak &smpPeak = mzBandSmpPeaks[j];
-                similVal += peakOverlap(refPeak, smpPeak);
+            float mzCenter = refPeaks.mz[i];
+            float mzWidth = 5;  // why 5??
+            double startMZ = mzCenter-mzWidth;
+            size_t k = lower_bound(sortedMZ.begin(), sortedMZ.end(), startMZ)-sortedMZ.begin();
+            for (; k<sortedMZ.size() && sortedMZ[k]<=(mzCenter+mzWidth); k++) {
+                similVal += peakOverlap(refPeaks, i, smpPeaks, byMZ[k]);
             }
         }
-        delete smpDB;
     }
     return similVal;
 }
 
-double Warp2D::peakOverlap(Peak& peak1,Peak& peak2) {
+double Warp2D::peakOverlap(const PeakTable::Columns& peaks1, size_t p1, const PeakTable::Columns& peaks2, size_t p2) {
 	// 
 	// Integrate the product of two gaussian densities representing the peaks.
 	//
 	// Retention time direction.
 	//
 
-    double ys1 = peak1.mYSig;
-    double ys2 = peak2.mYSig;
+    double ys1 = peaks1.rt_sigma[p1];
+    double ys2 = peaks2.rt_sigma[p2];
 	double rtsig1_sq = pow(ys1,2);
 	double rtsig2_sq = pow(ys2,2);
 	double rtsig_sq = (rtsig1_sq*rtsig2_sq)/(rtsig1_sq+rtsig2_sq);
 
-	double rtmu1 = peak1.mY;
-	double rtmu2 = peak2.mY;
+	double rtmu1 = peaks1.rt[p1];
+	double rtmu2 = peaks2.rt[p2];
 	double rtmu = (rtmu1*rtsig2_sq+rtmu2*rtsig1_sq)/(rtsig1_sq+rtsig2_sq);
 
 	double rtExpFac=0;
@@ -126,12 +142,12 @@ double Warp2D::peakOverlap(Peak& peak1,Peak& peak2) {
 	//
 	// M/Z direction.
 	//
-	double mzsig1_sq = pow(peak1.mXSig,2);
-	double mzsig2_sq = pow(peak2.mXSig,2);
+	double mzsig1_sq = pow(peaks1.mz_sigma[p1],2);
+	double mzsig2_sq = pow(peaks2.mz_sigma[p2],2);
 	double mzsig_sq = (mzsig1_sq*mzsig2_sq)/(mzsig1_sq+mzsig2_sq);
 
-	double mzmu1 = peak1.mX;
-	double mzmu2 = peak2.mX;
+	double mzmu1 = peaks1.mz[p1];
+	double mzmu2 = peaks2.mz[p2];
 	double mzmu = (mzmu1*mzsig2_sq+mzmu2*mzsig1_sq)/(mzsig1_sq+mzsig2_sq);
 
 	double mzExpFac=0;
@@ -146,7 +162,7 @@ double Warp2D::peakOverlap(Peak& peak1,Peak& peak2) {
 	//
 	// Intensity of peaks product.
 	//
-	double overlp = (rtExpFac*mzExpFac*   (peak1.mHeight)*   (peak2.mHeight));
+	double overlp = (rtExpFac*mzExpFac*   (peaks1.height[p1])*   (peaks2.height[p2]));
 
     return overlp;
 }
@@ -157,69 +173,67 @@ typedef struct FU {
 	int u;
 } FU;
 
-bool biggerPeakVolume(const Peak& peak1, const Peak& peak2) {
-	return (peak1.mVolume > peak2.mVolume);
-}
-
-bool biggerPeakHeight(const Peak& peak1, const Peak& peak2) {
-	return (peak1.mHeight > peak2.mHeight);
-}
-
-bool lessRTPeak(const Peak& peak1, const Peak& peak2) {
-	return (peak1.mY < peak2.mY);
-}
-
-vector<Peak> Warp2D::filterPeaks(vector<Peak> thePeaks, int nSegments) {
+PeakTable Warp2D::filterPeaks(const vector<Peak>& thePeaks, int nSegments) {
 	//
 	// Filter out minor peaks, so there are about maxNPeaksPSegmt peaks
 	// in each RT segment.
-	// We take the whole peak vector by value so the caller does not see
-	// a change of order in the peaks.
-	sort(thePeaks.begin(), thePeaks.end(), lessRTPeak);
-	vector<Peak> filteredPeaks;
-	double rtMin = (*thePeaks.begin()).mY;
-	double rtMax = (*--thePeaks.end()).mY;
+	// We sort the peak numbers rather than the peaks, so the caller does not
+	// see a change of order in the peaks.
+	PeakTable filteredPeaks;
+	if (thePeaks.empty())
+		return filteredPeaks;
+	vector<size_t> byRT(thePeaks.size());
+	for (size_t k=0; k<byRT.size(); k++)
+		byRT[k] = k;
+	sort(byRT.begin(), byRT.end(), [&thePeaks](size_t k1, size_t k2) {
+		return thePeaks[k1].mY < thePeaks[k2].mY;
+	});
+	double rtMin = thePeaks[byRT.front()].mY;
+	double rtMax = thePeaks[byRT.back()].mY;
 	double rtSeg = (rtMax-rtMin)/nSegments;
 	int k=0;
-        int max_k = (int)thePeaks.size();
+        int max_k = (int)byRT.size();
 	for (int i=1; i<=nSegments; i++) {
             double segEnd = rtMin+i*rtSeg;
-	    vector<Peak> byHeightPeaks;
-            Peak nextPeak;
-	    while ((k<max_k) && ((nextPeak=thePeaks[k]).mY <= segEnd)) {
-                byHeightPeaks.push_back(nextPeak);
+	    vector<size_t> byHeightPeaks;
+	    while ((k<max_k) && (thePeaks[byRT[k]].mY <= segEnd)) {
+                byHeightPeaks.push_back(byRT[k]);
                 k++;
             }
-	    sort(byHeightPeaks.begin(), byHeightPeaks.end(), biggerPeakHeight);
+	    sort(byHeightPeaks.begin(), byHeightPeaks.end(), [&thePeaks](size_t k1, size_t k2) {
+		return thePeaks[k1].mHeight > thePeaks[k2].mHeight;
+	    });
 	    int nTopPeaks = mymin(maxNPeaksPSegmt,byHeightPeaks.size());
 	    for (int l=0;l<nTopPeaks;l++)
-                filteredPeaks.push_back(byHeightPeaks[l]);
+                filteredPeaks.push_back(thePeaks[byHeightPeaks[l]]);
 	}
 	cout << "Warp2D> Peaks After filter: " << filteredPeaks.size() << " out of " << thePeaks.size() << endl;
 	return filteredPeaks;
 }
 
-void DumpPeaks(FILE *f, vector<Peak> &p, vector<Peak> &q) {
-    fprintf(f, "%5zd %5zd\n", p.size(), q.size());
-    int n = max(p.size(), q.size());
+void DumpPeaks(FILE *f, const PeakTable &p, pair<size_t, size_t> pRows, const PeakTable &q, pair<size_t, size_t> qRows) {
+    size_t pSize = pRows.second-pRows.first;
+    size_t qSize = qRows.second-qRows.first;
+    fprintf(f, "%5zd %5zd\n", pSize, qSize);
+    size_t n = max(pSize, qSize);
     int a0, b0;
     float a1, a2, a3, b1, b2, b3;
-    for (int i=0; i<n; i++) {
+    for (size_t i=0; i<n; i++) {
         a0 = b0 = 0;
         a1 = a2 = a3 = b1 = b2 = b3 = 0;
-        if (i < p.size()) {
-            Peak *s = &p[i];
-            a0 = s->mID;
-            a1 = s->mX;
-            a2 = s->mY;
-            a3 = s->mHeight;
+        if (i < pSize) {
+            size_t s = pRows.first+i;
+            a0 = p.details[s].mID;
+            a1 = p.mz[s];
+            a2 = p.rt[s];
+            a3 = p.height[s];
         }
-        if (i < q.size()) {
-            Peak *s = &q[i];
-            b0 = s->mID;
-            b1 = s->mX;
-            b2 = s->mY;
-            b3 = s->mHeight;
+        if (i < qSize) {
+            size_t s = qRows.first+i;
+            b0 = q.details[s].mID;
+            b1 = q.mz[s];
+            b2 = q.rt[s];
+            b3 = q.height[s];
         }
         fprintf(f, "%5d %5d %8f %8f %8f %8f %8f %8f\n", a0, b0, a1, b1, a2, b2, a3, b3);
     }
@@ -240,20 +254,13 @@ int Warp2D::cow_2D(vector<Peak>& refPeaksIn, vector<Peak>& smpPeaksIn, int nT, i
     // The number of segments.
     int N = nT/mT;
     nT = N*mT;	
-    vector<Peak> filtrdSmpPeaksdummy = filterPeaks(smpPeaksIn,N);
-    vector<Peak> filtrdRefPeaksdummy = filterPeaks(refPeaksIn,N);
-    vector<Peak>& filtrdRefPeaks = filtrdRefPeaksdummy; vector<Peak>& refPeaks = filtrdRefPeaks;
-    vector<Peak>& filtrdSmpPeaks = filtrdSmpPeaksdummy; vector<Peak>& smpPeaks = filtrdSmpPeaks;
+    PeakTable smpPeaks = filterPeaks(smpPeaksIn,N);
+    PeakTable refPeaks = filterPeaks(refPeaksIn,N);
 
     // Create peak DBs for fast lookup on RT.
     //
-    PeakWarpDB *refWarpDB = new PeakWarpDB(0);
-    for(int i=0;i<(int)refPeaks.size();i++)
-        refWarpDB->addPeak(refPeaks[i]);
-
-    PeakWarpDB *smpWarpDB = new PeakWarpDB(1);
-    for(int i=0;i<(int)smpPeaks.size();i++)
-        smpWarpDB->addPeak(smpPeaks[i]);
+    PeakWarpDB *refWarpDB = new PeakWarpDB(0, refPeaks);
+    PeakWarpDB *smpWarpDB = new PeakWarpDB(1, smpPeaks);
 
     // Select minimum time range containing both spectrums.
     //
@@ -355,11 +362,9 @@ int Warp2D::cow_2D(vector<Peak>& refPeaksIn, vector<Peak>& smpPeaksIn, int nT, i
     for( level=N; level>0; level--) {  
         double refTimeSegmt         = deltaRT*mT;
         double refTimeStart         = rtMin+(level-1)*refTimeSegmt;
-        vector<Peak> refPeaksdummy  = refWarpDB->getPeaksAtRTBand(refTimeStart+refTimeSegmt/2,refTimeSegmt/2);
-        vector<Peak>& refPeaks      = refPeaksdummy;
-        vector<Peak> smPeaksdummy   = smpWarpDB->getPeaksAtRTBand(refTimeStart+refTimeSegmt/2,refTimeSegmt/2);
-        vector<Peak> &smpPeaks      = smPeaksdummy;
-        unWarpedCorr               += similarity2D(refTimeStart, refTimeSegmt, refPeaks, refTimeStart, refTimeSegmt, smpPeaks);
+        PeakTable::Columns refBand  = refWarpDB->getPeaksAtRTBand(refTimeStart+refTimeSegmt/2,refTimeSegmt/2);
+        PeakTable::Columns smpBand  = smpWarpDB->getPeaksAtRTBand(refTimeStart+refTimeSegmt/2,refTimeSegmt/2);
+        unWarpedCorr               += similarity2D(refTimeStart, refTimeSegmt, refBand, refTimeStart, refTimeSegmt, smpBand);
     }
 
     if (debug2) {
@@ -375,8 +380,8 @@ int Warp2D::cow_2D(vector<Peak>& refPeaksIn, vector<Peak>& smpPeaksIn, int nT, i
         printf("\rProcessing segment : %d          ",level);
         double refTimeSegmt = deltaRT*mT;
         double refTimeStart = rtMin+(level-1)*refTimeSegmt;
-        vector<Peak> refPeaksd = refWarpDB->getPeaksAtRTBand(refTimeStart+refTimeSegmt/2,refTimeSegmt/2);
-        vector<Peak> &refPeaks = refPeaksd;
+        pair<size_t, size_t> refRows = refWarpDB->getRowsAtRTBand(refTimeStart+refTimeSegmt/2,refTimeSegmt/2);
+        PeakTable::Columns refBand = refWarpDB->getPeaks().View(refRows.first, refRows.second);
         for (int i=0; i<xlength[level]; i++) {
             int xi,xjmin,xjmax,jmin,jmax; FU *nodei;
             // Position of the node at level.
@@ -401,14 +406,14 @@ int Warp2D::cow_2D(vector<Peak>& refPeaksIn, vector<Peak>& smpPeaksIn, int nT, i
                 double smpTimeStart    = rtMin+xj*deltaRT;
                 double smpTimeSegmt    = (xi-xj) *deltaRT;
 
-                // this makes a copy of the peaks so the time can be changed in the samples
-                vector<Peak> smpPeakd  = smpWarpDB->getPeaksAtRTBand(smpTimeStart+smpTimeSegmt/2,smpTimeSegmt/2);
-                vector<Peak>& smpPeaks = smpPeakd;
+                // a view of the peaks, similarity2D() warps their times into a scratch column
+                pair<size_t, size_t> smpRows = smpWarpDB->getRowsAtRTBand(smpTimeStart+smpTimeSegmt/2,smpTimeSegmt/2);
+                PeakTable::Columns smpBand = smpWarpDB->getPeaks().View(smpRows.first, smpRows.second);
                 //
-                d = similarity2D(refTimeStart, refTimeSegmt, refPeaks, smpTimeStart, smpTimeSegmt, smpPeaks);
+                d = similarity2D(refTimeStart, refTimeSegmt, refBand, smpTimeStart, smpTimeSegmt, smpBand);
                 if (debug2) {
                     fprintf(f, "%5d %5d %5d %f\n", level, i, j, d);
-                    DumpPeaks(f, refPeaks, smpPeaks);
+                    DumpPeaks(f, refWarpDB->getPeaks(), refRows, smpWarpDB->getPeaks(), smpRows);
                 }
                 sum = d + nodei->f;
                 // store optimum path information
@@ -496,6 +501,7 @@ int Warp2D::cow_2D(vector<Peak>& refPeaksIn, vector<Peak>& smpPeaksIn, int nT, i
     for(int i=0; i<=N; i++) free(nodes[i]); free(nodes);
     free(xend); free(xlength); free(xstart);
     free(warping);
+    delete refWarpDB; delete smpWarpDB;
 
     return(1);
 }
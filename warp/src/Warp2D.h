@@ -15,13 +15,13 @@
 
 class Warp2D {
 
-	double peakOverlap(Peak& peak1,Peak& peak2);
-	double similarity2D(double refTimeStart, double refTimeSeg, std::vector<Peak>& refPeaks,
-						double smpTimeStart, double smpTimeSeg, std::vector<Peak>& smpPeaks);
+	double peakOverlap(const PeakTable::Columns& peaks1, size_t p1, const PeakTable::Columns& peaks2, size_t p2);
+	double similarity2D(double refTimeStart, double refTimeSeg, const PeakTable::Columns& refPeaks,
+						double smpTimeStart, double smpTimeSeg, const PeakTable::Columns& smpPeaks);
 	int cow_2D(std::vector<Peak>& refPeaks, std::vector<Peak>& smpPeaks, int nT, int mT, int t);
 
 	int binSearch(std::vector<double>& theVector, double target, int pIdx1, int rIdx1);
-	std::vector<Peak> filterPeaks(std::vector<Peak> thePeaks, int nSegments);
+	PeakTable filterPeaks(const std::vector<Peak>& thePeaks, int nSegments);
 
 	int windowSize_m;
 	int slack_t;
@@ -32,6 +32,7 @@ class Warp2D {
 	std::vector<double> origTime; std::vector<double> warpedTime; std::vector<double> segmtCorr;
 	double totalCorr; double unWarpedCorr;
 	int maxNPeaksPSegmt;
+	std::vector<double> smpWarpedRT; // Scratch column for the sample times warped by similarity2D().
 
 public:
 
@@ -49,6 +50,7 @@ public:
 	void computeWarp(std::vector<Peak>& referencePeaks, std::vector<Peak>& samplePeaks);
 
 	double similarity2D(std::vector<Peak>& refPeaks,std::vector<Peak>& smpPeaks);
+	double similarity2D(const PeakTable::Columns& refPeaks, const PeakTable::Columns& smpPeaks);
 	double getTotalCorr() { return totalCorr; }
 	double getTotalCorrUnWarped() { return unWarpedCorr; }
 
@@ -66,11 +68,11 @@ public:
 
         void findSimilarity(std::vector<Peak>& ref, std::vector<Peak>& smp, char *prefix = "") {
             int nseg = nTimePoints/windowSize_m;
-            std::vector<Peak> r = filterPeaks(ref, nseg);
-            std::vector<Peak> s = filterPeaks(smp, nseg);
-            double refover = similarity2D(r, r);
-            double sampover = similarity2D(s, s);
-            double overlap = similarity2D(r, s);
+            PeakTable r = filterPeaks(ref, nseg);
+            PeakTable s = filterPeaks(smp, nseg);
+            double refover = similarity2D(r.View(), r.View());
+            double sampover = similarity2D(s.View(), s.View());
+            double overlap = similarity2D(r.View(), s.View());
             std::cout << prefix << " similarity: ref, samp, overlap, GeometricRatio, MeanRatio: " << refover << " " << sampover << " " << overlap << " "
                  << overlap/sqrt(refover*sampover) << " " << 2*overlap/(refover+sampover) << std::endl;
 
@@ -82,11 +84,11 @@ public:
 	
         void findSimilarity(std::vector<Peak>& ref, std::vector<Peak>& smp, std::string prefix, std::map<std::string,std::string>& soutMap) {	    
             int nseg = nTimePoints/windowSize_m;
-            std::vector<Peak> r = filterPeaks(ref, nseg);
-            std::vector<Peak> s = filterPeaks(smp, nseg);
-            double refover = similarity2D(r, r);
-            double sampover = similarity2D(s, s);
-            double overlap = similarity2D(r, s);
+            PeakTable r = filterPeaks(ref, nseg);
+            PeakTable s = filterPeaks(smp, nseg);
+            double refover = similarity2D(r.View(), r.View());
+            double sampover = similarity2D(s.View(), s.View());
+            double overlap = similarity2D(r.View(), s.View());
             std::stringstream ss;
             std::map<std::string, std::string>::iterator iter;
             if(prefix.compare("UnWarped") == 0){            	